@@ -40,7 +40,8 @@ namespace
 
 EMANE::Models::TDMA::DownstreamQueueMgr::DownstreamQueueMgr():
   maxQueueSize_{QUEUE_SIZE_DEFAULT},
-  numDiscards_{}
+  numDiscards_{},
+  bytes_{}
 {}
 
 
@@ -68,6 +69,13 @@ EMANE::Models::TDMA::DownstreamQueueMgr::getCurrentDepth()
 }
 
 
+size_t 
+EMANE::Models::TDMA::DownstreamQueueMgr::getCurrentBytes()
+{ 
+   return bytes_;
+}
+
+
 size_t 
 EMANE::Models::TDMA::DownstreamQueueMgr::getMaxCapacity()
 { 
@@ -92,6 +100,8 @@ EMANE::Models::TDMA::DownstreamQueueMgr::dequeue()
   DownstreamQueueEntry entry{queue_.front()};
   
   queue_.pop_front();
+
+  bytes_ -= entry.pkt_.length();
   
   return {entry,true};
 }
@@ -107,11 +117,15 @@ EMANE::Models::TDMA::DownstreamQueueMgr::enqueue(DownstreamQueueEntry &entry)
      {
        ++numDiscards_;
 
+       bytes_ -= queue_.front().pkt_.length();
+
        result.push_back(std::move(queue_.front()));
 
        queue_.pop_front();
      }
 
+   bytes_ += entry.pkt_.length();
+
    queue_.push_back(std::move(entry));
 
    return result;
@@ -120,6 +134,8 @@ EMANE::Models::TDMA::DownstreamQueueMgr::enqueue(DownstreamQueueEntry &entry)
 void 
 EMANE::Models::TDMA::DownstreamQueueMgr::enqueue_front(DownstreamQueueEntry &entry) 
 { 
+   bytes_ += entry.pkt_.length();
+
    queue_.push_front(std::move(entry));
 }
 
@@ -153,6 +153,15 @@ namespace EMANE
          */
         size_t getCurrentDepth();
 
+        /**
+         * 
+         * @brief Returns the payload bytes currently queued
+         *
+         * @retval size_t bytes queued
+         *
+         */
+        size_t getCurrentBytes();
+
         /**
          * 
          * @brief Returns the max size of the queue
@@ -200,6 +209,7 @@ namespace EMANE
         DownstreamPacketQueue queue_;
         const size_t maxQueueSize_;
         size_t numDiscards_;
+        size_t bytes_;
       };
     }
   }
@@ -84,6 +84,27 @@ EMANE::Models::TDMA::DownstreamQueue::getCurrentDepth()
 }
 
 
+size_t 
+EMANE::Models::TDMA::DownstreamQueue::getCurrentDepth(std::uint8_t u8Priority)
+{ 
+   return u8Priority<QUEUE_PRIORITY_LEVEL ? queuemgr_[u8Priority].getCurrentDepth() : 0;
+}
+
+
+size_t 
+EMANE::Models::TDMA::DownstreamQueue::getCurrentBytes(std::uint8_t u8Priority)
+{ 
+   return u8Priority<QUEUE_PRIORITY_LEVEL ? queuemgr_[u8Priority].getCurrentBytes() : 0;
+}
+
+
+size_t 
+EMANE::Models::TDMA::DownstreamQueue::getNumClasses()
+{ 
+   return QUEUE_PRIORITY_LEVEL;
+}
+
+
 size_t 
 EMANE::Models::TDMA::DownstreamQueue::getMaxCapacity()
 { 
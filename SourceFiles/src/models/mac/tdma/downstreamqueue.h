@@ -89,6 +89,22 @@ namespace EMANE
          */
         size_t getCurrentDepth();
 
+        /**
+         * 
+         * @brief Returns the current size and payload bytes of one priority class
+         *
+         */
+        size_t getCurrentDepth(std::uint8_t u8Priority);
+
+        size_t getCurrentBytes(std::uint8_t u8Priority);
+
+        /**
+         * 
+         * @brief Returns the number of priority classes, 0 is served first
+         *
+         */
+        size_t getNumClasses();
+
         /**
          * 
          * @brief Returns the max size of the queue
@@ -56,91 +56,63 @@ EMANE::UpstreamPacket
 EMANE::Models::TDMA::FragmentManager::process(EMANE::UpstreamPacket & pkt, EMANE::PacketInfo info,  struct MacHeader * xmac)
 {
     EMANE::Models::TDMA::MACHeaderMessage mac(xmac->sequence,xmac->fragflag,xmac->datarate,xmac->len);
-    size_t num = buffer_.size();
-    bool exist = false;
     EMANE::UpstreamPacket ret(EMANE::PacketInfo(0,0,info.getPriority(),info.getCreationTime()),0,0);
     // get current time
     TimePoint currTime{Clock::now()};
 
-    for (size_t i=0;i<num;i++) {
-	FragmentItem item = buffer_.front();
-	buffer_.pop_front();
-	if (item.sour_ == info.getSource() && item.dest_ == info.getDestination() && item.pktseq_ == mac.getSequence()) {
-	    exist = true;
-	    int seq = mac.getFlag();
-	    if (seq>128) {
-		seq = seq-128;
-		item.total_ = seq;
-	    }
-	    if (seq == item.nextFrag_) {
-		item.nextFrag_++;
-		item.readylen_ += pkt.length();
-	    }
-	    FragPkt fpkt;
-	    fpkt.pkt_ = pkt;
-	    fpkt.seq_ = seq;
-	    item.readyFrag_.push(fpkt);
-	    if (item.nextFrag_>item.total_ && item.total_>0) {
-		// packet ready
-		unsigned char* buffer = new unsigned char[item.readylen_];
-		int loc = 0;
-		for (int i=1;i<=item.total_;i++) {
-		    bool ok = false;
-		    int k = item.readyFrag_.size();
-		    for ( int m=0; m<k; m++) {
-			FragPkt fp = item.readyFrag_.front();
-			item.readyFrag_.pop();
-			if (fp.seq_ == i) {
-			    ok = true;
-			    memcpy(&buffer[loc], fp.pkt_.get(), fp.pkt_.length());
-			    loc += fp.pkt_.length();
-			    break;
-			}
-			item.readyFrag_.push(fp);
-		    }
-		    if (!ok) {
-			// big trouble
-                      LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
-                                              ERROR_LEVEL,
-                                              "MACI %03hu %s::%s fragmentation error. source %d  dest %d",
-                                              id_,
-                                              pzLayerName,
-                                              __func__,
-						info.getSource(),
-						info.getDestination());
-		    }
-		}
-                ret = EMANE::UpstreamPacket(info,(void*)(buffer),(size_t) (item.readylen_));
+    int seq = mac.getFlag();
+    std::uint8_t total = 0;
+    if (seq>128) {
+	seq = seq-128;
+	total = seq;
+    }
 
-		delete [] buffer;
-	    }
-	    else
-		buffer_.push_back(item);
+    FragmentItemListIt found = buffer_.end();
+    for (FragmentItemListIt it = buffer_.begin(); it != buffer_.end(); ) {
+	if (it->sour_ == info.getSource() && it->dest_ == info.getDestination() && it->pktseq_ == mac.getSequence()) {
+	    found = it++;
+	}
+	else if (currTime - it->tpTimeout_ > timeout_) {
+	    // timeout remove it
+	    it = buffer_.erase(it);
 	}
-	else {
-	    // check, remove if timeout
-	    if (currTime - item.tpTimeout_ > timeout_) {
-		// timeout remove it
-	    }
-	    else {  // keep it
-		buffer_.push_back(item);
-	    }
+	else {  // keep it
+	    ++it;
 	}
+    }
+
+    if (found == buffer_.end()) {
+	// first frag of a packet, reserve the whole packet when the length is known
+	found = buffer_.emplace(buffer_.end(),info.getSource(),info.getDestination(),mac.getSequence(),
+				1,currTime+timeout_,total,xmac->total>0?xmac->total:pkt.length());
+    }
+
+    FragmentItem & item = *found;
+    if (total>0) item.total_ = total;
 
+    // only in order fragments can complete a packet, write them at their final offset
+    if (seq == item.nextFrag_) {
+	item.nextFrag_++;
+	item.append(pkt);
     }
-    if (!exist) {
-	// first frag of a packet
-	std::queue<FragPkt> q;
-	FragPkt fpkt;
-	fpkt.seq_ = mac.getFlag();
-	fpkt.pkt_ = pkt;
-	if (fpkt.seq_>128) fpkt.seq_ = fpkt.seq_ - 128;
-	ACE_UINT8 total=0,next = 1;
-	q.push(fpkt);
-	if (mac.getFlag()>128) total = mac.getFlag()-128;
-	if (mac.getFlag()==next) next++;
-	FragmentItem item(info.getSource(),info.getDestination(),mac.getSequence(),q,next,false,currTime+timeout_,total,next==1?0:pkt.length());
-	buffer_.push_back(item);
+    else {
+	// a lost or reordered fragment, the packet can no longer complete
+	LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+				ERROR_LEVEL,
+				"MACI %03hu %s::%s fragmentation error. source %d  dest %d fragment %d expected %d",
+				id_,
+				pzLayerName,
+				__func__,
+				info.getSource(),
+				info.getDestination(),
+				seq,
+				item.nextFrag_);
+    }
+
+    if (item.nextFrag_>item.total_ && item.total_>0) {
+	// packet ready, hand the reassembled buffer upstream
+	ret = EMANE::UpstreamPacket(info,item.buffer_.data(),item.readylen_);
+	buffer_.erase(found);
     }
 
     return ret;
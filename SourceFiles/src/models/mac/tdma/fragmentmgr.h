@@ -35,7 +35,8 @@
 
 #ifndef CRCTDMAFRAGMENT_HEADER_
 #define CRCTDMAFRAGMENT_HEADER_
-#include <queue>
+#include <list>
+#include <vector>
 #include "emane/maclayerimpl.h"
 #include "emane/mactypes.h"
 #include "tdmamacheadermessage.h"
@@ -47,61 +48,60 @@ namespace EMANE
     namespace TDMA
     {
 
- struct FragPktStru {
-    std::uint8_t seq_;
-    EMANE::UpstreamPacket pkt_;
-
-    FragPktStru() : seq_(0),pkt_(EMANE::PacketInfo(0,0,EMANE::Priority(0),Clock::now()),0,0) {}
- };
-
- typedef struct FragPktStru FragPkt;
-
+ /**
+  *
+  * @brief reassembly state of one fragmented packet. In order fragments
+  * are written straight into a single output buffer at their final
+  * offset, sized from the total length carried by the first fragment.
+  *
+  */
  class FragmentItem 
  {
   public:
    FragmentItem( EMANE::NEMId 	sour, 
 		EMANE::NEMId 	dest, 
 		std::uint8_t	pktseq,
-		std::queue<FragPkt>  readyFrag,
 		std::uint8_t	nextFrag, 
-		bool		ready,
 		TimePoint  	tpTimeout,   
 		std::uint8_t 	total, 
-		size_t		readylen
+		size_t		capacity
 			) :
      pktseq_(pktseq),
      nextFrag_(nextFrag),
-     readyFrag_(readyFrag),
      tpTimeout_(tpTimeout),
-     ready_(ready),
      dest_(dest),
      sour_(sour),
      total_(total),
-     readylen_(readylen)
-   { }
+     readylen_(0)
+   {
+     buffer_.reserve(capacity);
+   }
   
    FragmentItem() :
      pktseq_(0),
      nextFrag_(0),
      tpTimeout_(Clock::now()),
-     ready_(false),
      dest_(0),
      sour_(0),
      total_(0),
      readylen_(0)
    { }
 
+   void append(const EMANE::UpstreamPacket & pkt)
+   {
+     const std::uint8_t * p = static_cast<const std::uint8_t *>(pkt.get());
+     buffer_.insert(buffer_.end(), p, p + pkt.length());
+     readylen_ += pkt.length();
+   }
+
    std::uint8_t		pktseq_;
    std::uint8_t		nextFrag_;
-   std::queue<FragPkt>  readyFrag_;
    TimePoint    	tpTimeout_;                  // packet timeout time
-   bool			ready_;
    EMANE::NEMId 	dest_;
    EMANE::NEMId 	sour_;
    std::uint8_t		total_;
    size_t		readylen_;
-
-
+   std::vector<std::uint8_t> buffer_;            // reassembled packet
  };
 
  typedef std::list<FragmentItem> FragmentItemList;
@@ -50,15 +50,30 @@
 #include "emane/utils/conversionutils.h"
 #include "emane/utils/spectrumwindowutils.h"
 
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 
-std::mutex mgrLock_;
-EMANE::Models::TDMA::TDMAManager * tdmaManager_ = NULL;
-
 namespace
 {
   const char * pzLayerName{"TdmaMACLayer"};
 
+  // dynamic slot request: weight of the newest cycle in the arrival
+  // average, cycles each priority class may take to drain, the fraction
+  // of a slot of demand that does not justify another slot, and cycles
+  // the demand must stay lower before slots are given back
+  const float ARRIVAL_AVG_WEIGHT{0.25f};
+  const float CLASS_DRAIN_CYCLES[]{1.0f, 1.0f, 2.0f, 4.0f};
+  const float REQUEST_SLOT_SLACK{0.1f};
+  const std::uint64_t SHRINK_HOLD_CYCLES{4};
+
+  // distributed mode: a claim is used this many cycles after it is made,
+  // every NEM repeats its claim each CLAIM_ANNOUNCE_CYCLES and a claim not
+  // repeated for CLAIM_EXPIRY_PERIODS announcements is dropped
+  const std::uint64_t CLAIM_LEAD_CYCLES{2};
+  const std::uint64_t CLAIM_ANNOUNCE_CYCLES{16};
+  const std::uint64_t CLAIM_EXPIRY_PERIODS{3};
+
   const std::uint16_t DROP_CODE_SINR               = 1;
   const std::uint16_t DROP_CODE_REGISTRATION_ID    = 2;
   const std::uint16_t DROP_CODE_DST_MAC            = 3;
@@ -119,24 +134,65 @@ EMANE::Models::TDMA::MACLayer::MACLayer(NEMId id,
   queueMetricManager_(id),
   pNumDownstreamQueueDelay_{},
   radioMetricTimedEventId_{},
+  claimTimedEventId_{},
   commonLayerStatistics_{STATISTIC_TABLE_LABELS,{},"0"},
-  RNDZeroToOne_{0.0f, 1.0f},
-  pRNDJitter_{},
+  // unseeded runs differ, as with the clock seeded generators before
+  rndReception_{RandomStream::deriveSeed(std::chrono::system_clock::now().time_since_epoch().count(),
+                                         id, RandomStream::STREAM_RECEPTION)},
+  rndJitter_{RandomStream::deriveSeed(std::chrono::system_clock::now().time_since_epoch().count(),
+                                      id, RandomStream::STREAM_JITTER)},
   downstreamQueueTimedEventId_{},
   bHasPendingDownstreamQueueEntry_{},
   pendingDownstreamQueueEntry_{},
   fragmentManager_{id,pPlatformServiceProvider},
   tdmaReady_(false),
   dynamic_(false),
+  slotTables_{SlotTable{id},SlotTable{id}},
+  pActiveSlotTable_(&slotTables_[0]),
+  pPendingSlotTable_(&slotTables_[1]),
+  bHasPendingSlotTable_(false),
+  pendingSlotCycle_(0),
+  slotClaims_{id},
+  claimWant_(1),
   begin_send_(0),
   slot_send_(0),
   lastReqSlotNum_(0),
+  shrinkSlotNum_(-1),
+  u64ShrinkCycle_(0),
+  u64ArrivedPackets_(0),
+  u64ArrivedBytes_(0),
+  u64DemandPackets_(0),
+  u64DemandBytes_(0),
+  u64DemandCycle_(0),
+  fArrivalPacketsAvg_(0),
+  fArrivalBytesAvg_(0),
   usedSlotNum_(0),
+  slotMapVersion_(0),
+  bAwaitingSnapshot_(false),
   last_dyn_cycid_(0),
+  neighborsReported_(false),
+  managerUuid_{},
+  fOverheardCredit_(0),
+  overheardSINR_{},
+  batchReceptions_{},
+  batchSpans_{},
+  flushSpans_{},
+  flushWindows_{},
+  batchFlushTime_{},
+  u64BatchGeneration_(0),
+  eorReceptions_{},
+  dueReceptions_{},
+  eorTimerTime_{},
+  bEORTimerArmed_(false),
+  upstreamQueue_{},
   eventLock_{},
-  mgrLock_{},
+  pManager_(NULL),
   fJitterSeconds_{},
-  slot_map_str_{""}
+  slot_map_str_{""},
+  spatialReuse_(false),
+  distributedSlots_(false),
+  fOverheardSampleRate_(1.0f),
+  bSpectrumBatch_(false)
 {}
 
 EMANE::Models::TDMA::MACLayer::~MACLayer(){}
@@ -219,11 +275,14 @@ EMANE::Models::TDMA::MACLayer::initialize(Registrar & registrar)
                                                  " queues to backup.");
 
   configRegistrar.registerNonNumeric<std::string>("pcrcurveuri",
-                                                  ConfigurationProperties::REQUIRED,
+                                                  ConfigurationProperties::REQUIRED |
+                                                  ConfigurationProperties::MODIFIABLE,
                                                   {},
                                                   "Defines the absolute URI of the Packet Completion Rate (PCR) curve"
                                                   " file. The PCR curve file contains probability of reception curves"
-                                                  " as a function of Signal to Interference plus Noise Ratio (SINR).");
+                                                  " as a function of Signal to Interference plus Noise Ratio (SINR)."
+                                                  " A new value is loaded in the background while the current curves"
+                                                  " stay in use.");
 
   configRegistrar.registerNumeric<bool>("radiometricenable",
                                         ConfigurationProperties::DEFAULT,
@@ -317,7 +376,9 @@ EMANE::Models::TDMA::MACLayer::initialize(Registrar & registrar)
   configRegistrar.registerNumeric<std::uint16_t>("macheaderlen",
                                          ConfigurationProperties::DEFAULT,
                                          {3},
-                                         "Defines emulated MAC protocol header length (bytes).",
+                                         "Defines emulated MAC protocol header length (bytes)."
+                                         " The length is accounted for in the transmission duration"
+                                         " only, it is not sent over the air.",
                                          3,
                                          200);
 
@@ -336,6 +397,44 @@ EMANE::Models::TDMA::MACLayer::initialize(Registrar & registrar)
 						 0,
 						 1000000);
 
+  configRegistrar.registerNumeric<bool>("spatialreuse",
+                                        ConfigurationProperties::DEFAULT,
+                                        {false},
+                                        "Defines if one-hop neighbors are reported to the TDMA manager so that"
+                                        " NEMs more than two hops apart may share slots.");
+
+  configRegistrar.registerNumeric<bool>("distributedslots",
+                                        ConfigurationProperties::DEFAULT,
+                                        {false},
+                                        "Defines if NEMs claim slots among themselves instead of through an"
+                                        " elected TDMA manager. Slot zero is then the start of the epoch.");
+
+  configRegistrar.registerNumeric<float>("overheardsamplerate",
+                                         ConfigurationProperties::DEFAULT |
+                                         ConfigurationProperties::MODIFIABLE,
+                                         {1.0f},
+                                         "Defines the fraction of overheard unicast packets, those for another"
+                                         " NEM with promiscuous mode off, that get a spectrum query for their"
+                                         " SINR. The rest are judged at arrival against the last SINR measured"
+                                         " from their source, only to keep neighbor metrics. 1 queries all,"
+                                         " 0 queries each source once.",
+                                         0.0f,
+                                         1.0f);
+
+  configRegistrar.registerNumeric<bool>("spectrumbatch",
+                                        ConfigurationProperties::DEFAULT,
+                                        {false},
+                                        "Defines if receptions ending in the same slot are processed together"
+                                        " at the end of the slot, with one spectrum window request covering all"
+                                        " of them instead of one per packet. Delays reception by up to a slot.");
+
+  configRegistrar.registerNumeric<std::uint64_t>("randomseed",
+                                                 ConfigurationProperties::DEFAULT,
+                                                 {0},
+                                                 "Defines the scenario seed from which each NEM derives its own"
+                                                 " reception and jitter random streams. The same seed repeats the"
+                                                 " same draws. 0 seeds from the clock.");
+
 
   auto & statisticRegistrar = registrar.statisticRegistrar();
 
@@ -437,14 +536,6 @@ EMANE::Models::TDMA::MACLayer::configure(const ConfigurationUpdate & update)
         {
           fJitterSeconds_ = item.second[0].asFloat();
 
-          if(fJitterSeconds_ > 0.0f)
-            {
-              // create a random mumber distrubtion +- the jitter range
-              pRNDJitter_.reset(new Utils::RandomNumberDistribution<std::mt19937, 
-                                std::uniform_real_distribution<float>>
-                                (-fJitterSeconds_ / 2.0f, fJitterSeconds_ / 2.0));
-            }
-
           LOGGER_STANDARD_LOGGING(pPlatformService_->logService(), 
                                   INFO_LEVEL,
                                   "MACI %03hu %s::%s %s = %f", 
@@ -673,9 +764,84 @@ EMANE::Models::TDMA::MACLayer::configure(const ConfigurationUpdate & update)
                                   item.first.c_str(),
                                   std::chrono::duration_cast<Microseconds>(dynamicLength_).count());
         }
+      else if(item.first == "spatialreuse")
+        {
+          spatialReuse_ = item.second[0].asBool();
+
+          LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+                                  INFO_LEVEL,
+                                  "MACI %03hu %s::%s %s = %s",
+                                  id_,
+                                  pzLayerName,
+                                  __func__,
+                                  item.first.c_str(),
+                                  spatialReuse_ ? "on" : "off");
+        }
+      else if(item.first == "distributedslots")
+        {
+          distributedSlots_ = item.second[0].asBool();
+
+          LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+                                  INFO_LEVEL,
+                                  "MACI %03hu %s::%s %s = %s",
+                                  id_,
+                                  pzLayerName,
+                                  __func__,
+                                  item.first.c_str(),
+                                  distributedSlots_ ? "on" : "off");
+        }
+      else if(item.first == "overheardsamplerate")
+        {
+          fOverheardSampleRate_ = item.second[0].asFloat();
+
+          LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+                                  INFO_LEVEL,
+                                  "MACI %03hu %s::%s %s = %f",
+                                  id_,
+                                  pzLayerName,
+                                  __func__,
+                                  item.first.c_str(),
+                                  fOverheardSampleRate_);
+        }
+      else if(item.first == "spectrumbatch")
+        {
+          bSpectrumBatch_ = item.second[0].asBool();
+
+          LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+                                  INFO_LEVEL,
+                                  "MACI %03hu %s::%s %s = %s",
+                                  id_,
+                                  pzLayerName,
+                                  __func__,
+                                  item.first.c_str(),
+                                  bSpectrumBatch_ ? "on" : "off");
+        }
+      else if(item.first == "randomseed")
+        {
+          const std::uint64_t u64Seed{item.second[0].asUINT64()};
+
+          if(u64Seed)
+            {
+              rndReception_.seed(RandomStream::deriveSeed(u64Seed, id_, RandomStream::STREAM_RECEPTION));
+              rndJitter_.seed(RandomStream::deriveSeed(u64Seed, id_, RandomStream::STREAM_JITTER));
+            }
+
+          LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+                                  INFO_LEVEL,
+                                  "MACI %03hu %s::%s %s = %ju",
+                                  id_,
+                                  pzLayerName,
+                                  __func__,
+                                  item.first.c_str(),
+                                  u64Seed);
+        }
       else if(item.first == "timeslotnum")
         {
           slotNumInCycle_ = item.second[0].asUINT16();
+
+          slotTables_[0].resize(slotNumInCycle_);
+          slotTables_[1].resize(slotNumInCycle_);
+          slotClaims_.resize(slotNumInCycle_);
              
           LOGGER_STANDARD_LOGGING(pPlatformService_->logService(), 
                                   INFO_LEVEL,
@@ -823,15 +989,9 @@ EMANE::Models::TDMA::MACLayer::postStart()
                           pzLayerName,
                           __func__);
 
-  mgrLock_.lock();
-  if (tdmaManager_ == NULL) {
-     tdmaManager_ = new EMANE::Models::TDMA::TDMAManager{pPlatformService_};
-     tdmaManager_->initialize(std::auto_ptr<EMANE::Models::TDMA::MACLayer>{this},id_);
-  }
-  if (tdmaManager_->isInited() == false) {
-      sleep(1.2);
-  }
-  mgrLock_.unlock();
+  // no manager to join in distributed mode
+  if (!distributedSlots_)
+    pManager_ = TDMAManagerRegistry::instance().registerLayer(this,id_,pPlatformService_);
 
 
   // check flow control enabled 
@@ -855,20 +1015,31 @@ EMANE::Models::TDMA::MACLayer::postStart()
       scheduleTimedEvent(Clock::now() + radioMetricReportIntervalMicroseconds_,
                          new std::function<bool()>{[this]()
                              {
-                               if(!bRadioMetricEnable_)
+                               if(!bRadioMetricEnable_ && !spatialReuse_)
                                  {
                                    neighborMetricManager_.updateNeighborStatus();
                                  }
                                else
                                  {
-                                   ControlMessages msgs{
-                                       Controls::R2RISelfMetricControlMessage::create(getDataRate(datarate_),
-                                                                                      getDataRate(datarate_),
-                                                                                      radioMetricReportIntervalMicroseconds_),
-                                       Controls::R2RINeighborMetricControlMessage::create(neighborMetricManager_.getNeighborMetrics()),
-                                       Controls::R2RIQueueMetricControlMessage::create(queueMetricManager_.getQueueMetrics())};
-
-                                    sendUpstreamControl(msgs);
+                                   // also updates the neighbor status
+                                   Controls::R2RINeighborMetrics metrics{neighborMetricManager_.getNeighborMetrics()};
+
+                                   if(spatialReuse_)
+                                     {
+                                       reportNeighbors(metrics);
+                                     }
+
+                                   if(bRadioMetricEnable_)
+                                     {
+                                       ControlMessages msgs{
+                                           Controls::R2RISelfMetricControlMessage::create(getDataRate(datarate_),
+                                                                                          getDataRate(datarate_),
+                                                                                          radioMetricReportIntervalMicroseconds_),
+                                           Controls::R2RINeighborMetricControlMessage::create(metrics),
+                                           Controls::R2RIQueueMetricControlMessage::create(queueMetricManager_.getQueueMetrics())};
+
+                                       sendUpstreamControl(msgs);
+                                     }
                                  }
 
                                 return false;
@@ -885,13 +1056,27 @@ EMANE::Models::TDMA::MACLayer::postStart()
 
   timeslotByte_ = getDataRate(datarate_)*(timeSlotLength_-guardTime_).count()/1000000/8;
 
-  // send request event to get TDMA info
-   auto timeNow = Clock::now();
-   auto time1S = Microseconds(1300000);
-   nemREventId_ = pPlatformService_->timerService().
-        scheduleTimedEvent(timeNow+time1S,
-                           new std::function<bool()>{std::bind(&MACLayer::sendInitRevent,
-                                                                   this)});
+  if (distributedSlots_) {
+    // all NEMs share the epoch as slot zero, claims take it from there
+    tdmaBaseTime_ = 0;
+    tdmaReady_ = true;
+    claimSlots(claimWant_);
+
+    claimTimedEventId_ =
+      pPlatformService_->timerService().
+        scheduleTimedEvent(Clock::now() + getClaimPeriod(),
+                           new std::function<bool()>{[this]()
+                               {
+                                 announceClaim();
+                                 return false;
+                               }},
+                           getClaimPeriod());
+  }
+  else {
+    // send request event to get TDMA info, it is sent again whenever a
+    // manager announces itself in case no manager was elected yet
+    sendInitRevent();
+  }
 }
 
 bool 
@@ -916,6 +1101,8 @@ EMANE::Models::TDMA::MACLayer::sendInitRevent()
   EMANE::Models::TDMA::TdmaREvent event(id_,EMANE::Models::TDMA::TDMA_TYPE_NEMINIT,smap,macsubid_,slotNumInCycle_,dynamic_?timeSlotLen_:0);
   proxyEvent(id_,0,event);
   nemREventId_ = 0;
+  // a new manager has not seen our neighbors yet
+  neighborsReported_ = false;
   LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
                           DEBUG_LEVEL,
                           "MACI %03hu %s::%s: TDMA INIT event sent", 
@@ -926,6 +1113,54 @@ EMANE::Models::TDMA::MACLayer::sendInitRevent()
   return true;
 }
 
+void
+EMANE::Models::TDMA::MACLayer::joinManager(const std::string & uuid)
+{
+  // the manager re-announces itself to every newcomer, the NEMs already
+  // holding its map stay quiet
+  if (tdmaReady_ && uuid == managerUuid_)
+    return;
+
+  managerUuid_ = uuid;
+  sendInitRevent();
+}
+
+void
+EMANE::Models::TDMA::MACLayer::reportNeighbors(const Controls::R2RINeighborMetrics & metrics)
+{
+  NeighborList neighbors;
+
+  neighbors.reserve(metrics.size());
+
+  for(const auto & metric : metrics)
+    {
+      neighbors.push_back(metric.getId());
+    }
+
+  std::sort(neighbors.begin(), neighbors.end());
+
+  // the manager keeps the last report, only send changes
+  if(neighborsReported_ && neighbors == reportedNeighbors_)
+    {
+      return;
+    }
+
+  EMANE::Models::TDMA::TdmaREvent event(id_,EMANE::Models::TDMA::TDMA_TYPE_NEIGHBORS,
+	"",macsubid_,slotNumInCycle_,dynamicLen_,neighbors);
+  proxyEvent(id_,0,event);
+
+  reportedNeighbors_.swap(neighbors);
+  neighborsReported_ = true;
+
+  LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+                          DEBUG_LEVEL,
+                          "MACI %03hu %s::%s: TDMA neighbors event sent, %zu neighbors",
+                          id_,
+                          pzLayerName,
+                          __func__,
+                          reportedNeighbors_.size());
+}
+
 void 
 EMANE::Models::TDMA::MACLayer::processConfiguration(const ConfigurationUpdate & update)
 {
@@ -966,18 +1201,39 @@ EMANE::Models::TDMA::MACLayer::processConfiguration(const ConfigurationUpdate &
                                   item.first.c_str(), 
                                   datarate_);
         }
+      else if(item.first == "overheardsamplerate")
+        {
+          fOverheardSampleRate_ = item.second[0].asFloat();
+
+          LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+                                  DEBUG_LEVEL,
+                                  "MACI %03hu %s::%s %s = %f",
+                                  id_,
+                                  pzLayerName,
+                                  __func__,
+                                  item.first.c_str(),
+                                  fOverheardSampleRate_);
+        }
+      else if(item.first == "pcrcurveuri")
+        {
+          sPCRCurveURI_ = item.second[0].asString();
+
+          // built off the receive path, swapped in once loaded
+          pcrManager_.reload(sPCRCurveURI_);
+
+          LOGGER_STANDARD_LOGGING(pPlatformService_->logService(), 
+                                  INFO_LEVEL,
+                                  "MACI %03hu %s::%s %s = %s",
+                                  id_, 
+                                  pzLayerName, 
+                                  __func__, 
+                                  item.first.c_str(),
+                                  sPCRCurveURI_.c_str());
+        }
       else if(item.first == "jitter")
         {
           fJitterSeconds_ = item.second[0].asFloat();
 
-          if(fJitterSeconds_ > 0.0f)
-            {
-              // create a random mumber distrubtion +- the jitter range
-              pRNDJitter_.reset(new Utils::RandomNumberDistribution<std::mt19937, 
-                                std::uniform_real_distribution<float>>
-                                (-fJitterSeconds_ / 2.0f, fJitterSeconds_ / 2.0));
-            }
-
           LOGGER_STANDARD_LOGGING(pPlatformService_->logService(), 
                                   DEBUG_LEVEL,
                                   "MACI %03hu %s::%s %s = %f", 
@@ -1110,6 +1366,21 @@ EMANE::Models::TDMA::MACLayer::stop()
 
   downstreamQueueTimedEventId_ = 0;
 
+  if (distributedSlots_) {
+    pPlatformService_->timerService().cancelTimedEvent(claimTimedEventId_);
+
+    claimTimedEventId_ = 0;
+
+    // release everything so others need not wait for us
+    slotClaims_.update(id_,SlotList{});
+    sendClaim();
+  }
+  else {
+    TDMAManagerRegistry::instance().unregisterLayer(this);
+
+    pManager_ = NULL;
+  }
+
   // check flow control enabled
   if(bFlowControlEnable_)
     {
@@ -1331,206 +1602,70 @@ EMANE::Models::TDMA::MACLayer::processUpstreamPacket(const CommonMACHeader & com
           // [startofreception-calculation-snibbet] /
 
           Microseconds span{pReceivePropertiesControlMessage->getSpan()};
-            
-          auto pCallback =
-            new std::function<bool()>(std::bind([this,
-                                                 startOfReception,
-                                                 frequencySegments,
-                                                 span,
-                                                 beginTime](UpstreamPacket & pkt,
-                                                            std::uint64_t u64SequenceNumber,
-                                                            std::uint64_t u64DataRate,
-							    std::uint8_t sequence, std::uint8_t fragment, std::uint8_t datarate, std::uint8_t len)
+
+          // overheard unicast, the destination alone decides it is dropped so
+          // between samples skip the timer and spectrum query, only keeping
+          // neighbor metrics from the last sinr measured from its source
+          if(!bPromiscuousMode_ &&
+             pktInfo.getDestination() != id_ &&
+             pktInfo.getDestination() != NEM_BROADCAST_MAC_ADDRESS &&
+             !sampleOverheard(pktInfo.getSource()))
             {
-              const PacketInfo & pktInfo{pkt.getPacketInfo()};
-              
-              const FrequencySegment & frequencySegment{*frequencySegments.begin()};
-              
-              LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                     DEBUG_LEVEL,
-                                     "MACI %03hu %s upstream EOR processing: src %hu, dst %hu,"
-                                     " len %zu, freq %ju, offset %ju, duration %ju, mac sequence %ju",
-                                     id_,
-                                     pzLayerName,
-                                     pktInfo.getSource(),
-                                     pktInfo.getDestination(),
-                                     pkt.length(),
-                                     frequencySegment.getFrequencyHz(),
-                                     frequencySegment.getOffset().count(),
-                                     frequencySegment.getDuration().count(),
-                                     u64SequenceNumber);
-              
-              
-              double dSINR{};
-             
-              double dNoiseFloordB{};
+              const auto & sinr = overheardSINR_[pktInfo.getSource()];
 
+              const bool bReceived{checkPOR(sinr.first, pkt.length(), tdmaMACHeader.getDataRate())};
 
-              try
-                {
-                  // [spectrumservice-request-snibbet] /
-                  // get the spectrum info for the entire span, where a span
-                  // is the total time between the start of the signal of the
-                  // earliest segment and the end of the signal of the latest
-                  // segment. This is not necessarily the signal duration.
-                  auto window = pRadioService_->spectrumService().request(frequencySegment.getFrequencyHz(),
-                                                                          span,
-                                                                          startOfReception);
-
-                  // since we only have a single segment the span will equal the segment duration.
-                  // For simple noise processing we will just pull out the max noise segment, we can
-                  // use the maxBinNoiseFloor utility function for this. More elaborate noise window analysis
-                  // will require a more complex algorithm, although you should get a lot of mileage out of 
-                  // this utility function.
-                  bool bSignalInNoise{};
-
-                  std::tie(dNoiseFloordB,bSignalInNoise) =
-                    Utils::maxBinNoiseFloor(window,frequencySegment.getRxPowerdBm());
-                  
-                  dSINR = frequencySegment.getRxPowerdBm() - dNoiseFloordB;
-                  // [spectrumservice-request-snibbet] /
-
-                  LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                         DEBUG_LEVEL,
-                                         "MACI %03hu %s upstream EOR processing: src %hu, dst %hu, max noise %f, signal in noise %s, SINR %f",
-                                         id_,
-                                         pzLayerName,
-                                         pktInfo.getSource(),
-                                         pktInfo.getDestination(),
-                                         dNoiseFloordB,
-                                         bSignalInNoise ? "yes" : "no",
-                                         dSINR);
-                }
-              catch(SpectrumServiceException & exp)
+              if(bReceived)
                 {
-                  LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                         ERROR_LEVEL,
-                                         "MACI %03hu %s upstream EOR processing: src %hu, dst %hu, sor %ju, span %ju spectrum service request error: %s",
-                                         id_,
-                                         pzLayerName,
-                                         pktInfo.getSource(),
-                                         pktInfo.getDestination(),
-                                         std::chrono::duration_cast<Microseconds>(startOfReception.time_since_epoch()).count(),
-                                         span.count(),
-                                         exp.what());
-                  
-                  commonLayerStatistics_.processOutbound(pkt, 
-                                                         std::chrono::duration_cast<Microseconds>(Clock::now() - beginTime), 
-                                                         DROP_CODE_BAD_SPECTRUM_QUERY);
-                  // drop
-                  return true;
+                  neighborMetricManager_.updateNeighborRxMetric(pktInfo.getSource(),
+                                                                commonMACHeader.getSequenceNumber(),
+                                                                pktInfo.getUUID(),
+                                                                sinr.first,
+                                                                sinr.second,
+                                                                startOfReception,
+                                                                frequencySegments.begin()->getDuration(),
+                                                                getDataRate(tdmaMACHeader.getDataRate()));
                 }
 
-              const Microseconds & durationMicroseconds{frequencySegment.getDuration()};
-              
-              // check sinr
-              if(!checkPOR(dSINR, pkt.length(),1))
-                {
-                  LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                         DEBUG_LEVEL,
-                                         "MACI %03hu %s upstream EOR processing: src %hu, dst %hu, "
-                                         "rxpwr %3.2f dBm, drop",
-                                         id_,
-                                         pzLayerName,
-                                         pktInfo.getSource(),
-                                         pktInfo.getDestination(),
-                                         frequencySegment.getRxPowerdBm());
-                  
-                  commonLayerStatistics_.processOutbound(pkt, 
-                                                         std::chrono::duration_cast<Microseconds>(Clock::now() - beginTime), 
-                                                         DROP_CODE_SINR);
-                  
-                  // drop
-                  return true;
-                }
-              
-              // update neighbor metrics 
-              neighborMetricManager_.updateNeighborRxMetric(pktInfo.getSource(),    // nbr (src)
-                                                            u64SequenceNumber,      // sequence number
-                                                            pktInfo.getUUID(),
-                                                            dSINR,                  // sinr in dBm
-                                                            dNoiseFloordB,          // noise floor in dB
-                                                            startOfReception,       // rx time
-                                                            durationMicroseconds,   // duration
-                                                            u64DataRate);           // data rate bps
-             
-              // check promiscuous mode, destination is this nem or to all nem's
-              if(bPromiscuousMode_ ||
-                 (pktInfo.getDestination() == id_) ||
-                 (pktInfo.getDestination() == NEM_BROADCAST_MAC_ADDRESS))
-                {
-                  LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                         DEBUG_LEVEL,
-                                         "MACI %03hu %s upstream EOR processing: src %hu, dst %hu, forward upstream   len %d",
-                                         id_,
-                                         pzLayerName,
-                                         pktInfo.getSource(),
-                                         pktInfo.getDestination(),
-					 pkt.length());
-                  
-                  commonLayerStatistics_.processOutbound(pkt,
-                                                         std::chrono::duration_cast<Microseconds>(Clock::now() - beginTime));
-                  
-		  MACHeaderMessage tdmaMACHeader(sequence,fragment,datarate,len);
-                  if (tdmaMACHeader.isFragment()) {
-                  	LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                         DEBUG_LEVEL,
-                                         "MACI FRAG %03hu %s origin %hu, dst %hu, len %zu fseq: %d",
-                                         id_,
-                                         pzLayerName,
-                                         pktInfo.getSource(),
-                                         pktInfo.getDestination(),
-					 pkt.length(),
-					 tdmaMACHeader.getFlag());
-			struct MacHeader mh;
-			mh.sequence = tdmaMACHeader.getSequence(); mh.fragflag = tdmaMACHeader.getFlag(); 
-			mh.datarate = tdmaMACHeader.getDataRate(); mh.len = tdmaMACHeader.getLen();
-			EMANE::UpstreamPacket fpkt = fragmentManager_.process(pkt,pkt.getPacketInfo(),&mh);
-			if (fpkt.length()>0) {
-	   			sendUpstreamPacket(fpkt);
-			}
-		  }
-		  else {
-                  	sendUpstreamPacket(pkt);
-                  }
-                  
-                  // done
-                  return true;
-                }
-              else
-                {
-                  LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                         DEBUG_LEVEL,
-                                         "MACI %03hu %s upstream EOR processing: not for this nem, "
-                                         "ignore pkt src %hu, dst %hu, drop",
-                                         id_,
-                                         pzLayerName,
-                                         pktInfo.getSource(),
-                                         pktInfo.getDestination());
-                  
-                  commonLayerStatistics_.processOutbound(pkt, 
-                                                         std::chrono::duration_cast<Microseconds>(Clock::now() - beginTime), 
-                                                         DROP_CODE_DST_MAC);
-                  
-                  // drop 
-                  return true;
-                }
-            },pkt,commonMACHeader.getSequenceNumber(),getDataRate(tdmaMACHeader.getDataRate()),tdmaMACHeader.getSequence(),tdmaMACHeader.getFlag(),tdmaMACHeader.getDataRate(),tdmaMACHeader.getLen()));
+              commonLayerStatistics_.processOutbound(pkt,
+                                                     std::chrono::duration_cast<Microseconds>(Clock::now() - beginTime),
+                                                     bReceived ? DROP_CODE_DST_MAC : DROP_CODE_SINR);
 
+              // drop
+              return;
+            }
+            
+          Reception reception{pkt,
+                              startOfReception,
+                              frequencySegments,
+                              span,
+                              beginTime,
+                              commonMACHeader.getSequenceNumber(),
+                              getDataRate(tdmaMACHeader.getDataRate()),
+                              tdmaMACHeader.getSequence(),
+                              tdmaMACHeader.getFlag(),
+                              tdmaMACHeader.getDataRate(),
+                              tdmaMACHeader.getLen(),
+                              tdmaMACHeader.getTotal()};
 
           auto eor = startOfReception + frequencySegments.begin()->getDuration();
 
-          if(eor > beginTime)
+          if(bSpectrumBatch_ && queueReception(reception))
+            {
+              // processed with the rest of its slot, a later slot may have flushed
+              deliverUpstream();
+            }
+          else if(eor > beginTime)
             {
               // wait for end of reception to complete processing
-              pPlatformService_->timerService().scheduleTimedEvent(eor,pCallback);
+              queueEOR(eor, std::move(reception));
             }
           else
             {
               // we can process now, end of reception has past
-              (*pCallback)();
-              
-              delete pCallback;
+              processReceptions(&reception, 1);
+
+              deliverUpstream();
             }
         }
     }
@@ -1597,6 +1732,10 @@ EMANE::Models::TDMA::MACLayer::processDownstreamPacket(DownstreamPacket & pkt,
   }
 
 
+  // offered load, feeds the dynamic slot request
+  ++u64ArrivedPackets_;
+  u64ArrivedBytes_ += pkt.length();
+
   // get duration
   Microseconds durationMicroseconds{getDurationMicroseconds(pkt.length(),getDataRate(datarate_))};
  
@@ -1661,27 +1800,149 @@ EMANE::Models::TDMA::MACLayer::processDownstreamPacket(DownstreamPacket & pkt,
     }
 }
 
+void 
+EMANE::Models::TDMA::MACLayer::claimSlots(std::uint16_t want)
+{
+  claimWant_ = want;
+  if (slotClaims_.claim(claimWant_)) {
+    sendClaim();
+    scheduleClaimedSlots();
+  }
+}
+
+void 
+EMANE::Models::TDMA::MACLayer::sendClaim()
+{
+  EMANE::Models::TDMA::TdmaREvent event(id_,EMANE::Models::TDMA::TDMA_TYPE_CLAIM,
+	"",macsubid_,slotNumInCycle_,0,NeighborList{},slotClaims_.getClaim());
+  proxyEvent(id_,0,event);
+}
+
+EMANE::Microseconds
+EMANE::Models::TDMA::MACLayer::getClaimPeriod() const
+{
+  return Microseconds((dynamicLen_+timeSlotLen_*slotNumInCycle_)*CLAIM_ANNOUNCE_CYCLES);
+}
+
+void 
+EMANE::Models::TDMA::MACLayer::announceClaim()
+{
+  // a NEM that left without releasing its claim stops repeating it
+  bool changed = slotClaims_.expire(Clock::now() - getClaimPeriod()*CLAIM_EXPIRY_PERIODS);
+  if (slotClaims_.claim(claimWant_)) changed = true;
+  sendClaim();
+  if (changed)
+    scheduleClaimedSlots();
+}
+
+void 
+EMANE::Models::TDMA::MACLayer::scheduleClaimedSlots()
+{
+  std::uint64_t nowus = getScheduleTime(Clock::now());
+  std::uint64_t cycleid = (nowus - tdmaBaseTime_)/(dynamicLen_+timeSlotLen_*slotNumInCycle_);
+
+  std::lock_guard<std::mutex> m(eventLock_);
+  slotClaims_.fill(*pPendingSlotTable_);
+  // claims made this cycle reach the others before they are used. The switch
+  // is on a fixed grid of CLAIM_LEAD_CYCLES, and a table already waiting keeps
+  // its deadline, so claims changing every cycle cannot postpone it forever
+  if (!bHasPendingSlotTable_)
+    pendingSlotCycle_ = (cycleid+2*CLAIM_LEAD_CYCLES-1)/CLAIM_LEAD_CYCLES*CLAIM_LEAD_CYCLES;
+  bHasPendingSlotTable_ = true;
+}
+
+void 
+EMANE::Models::TDMA::MACLayer::activateSlotTable(std::uint64_t cycleid)
+{
+  if (!bHasPendingSlotTable_) return;
+
+  std::lock_guard<std::mutex> m(eventLock_);
+  if (bHasPendingSlotTable_ && cycleid >= pendingSlotCycle_) {
+    // the manager's activation cycle, or the claim grid point
+    std::swap(pActiveSlotTable_, pPendingSlotTable_);
+    bHasPendingSlotTable_ = false;
+    usedSlotNum_ = pActiveSlotTable_->getOwnedCount();
+  }
+}
+
 int 
 EMANE::Models::TDMA::MACLayer::getSynSlotNum()
 {
-   size_t queuelen = downstreamQueue_.getCurrentDepth();
-   int ret = (bHasPendingDownstreamQueueEntry_||(queuelen>0))?1:0;
-   if (ret>0) {
-      ret = queuelen/5;
-      if (aggregationEnable_) ret = ret/2;
-      if (ret>(slotNumInCycle_/2+1)) ret = slotNumInCycle_/2+1;
-      if (ret==0) ret = 1;
+   // arrivals per cycle, averaged once per cycle however often we are asked
+   std::uint64_t nowus = getScheduleTime(Clock::now());
+   std::uint64_t cycleid = (nowus - tdmaBaseTime_)/(dynamicLen_+timeSlotLen_*slotNumInCycle_);
+   if (cycleid != u64DemandCycle_) {
+      std::uint64_t cycles = u64DemandCycle_ ? cycleid - u64DemandCycle_ : 1;
+      float keep = std::pow(1.0f - ARRIVAL_AVG_WEIGHT, static_cast<float>(cycles));
+      fArrivalPacketsAvg_ = keep * fArrivalPacketsAvg_ +
+	(1.0f - keep) * (u64ArrivedPackets_ - u64DemandPackets_) / cycles;
+      fArrivalBytesAvg_ = keep * fArrivalBytesAvg_ +
+	(1.0f - keep) * (u64ArrivedBytes_ - u64DemandBytes_) / cycles;
+      u64DemandPackets_ = u64ArrivedPackets_;
+      u64DemandBytes_ = u64ArrivedBytes_;
+      u64DemandCycle_ = cycleid;
    }
-   if (ret == lastReqSlotNum_) return -1;	// no req required
-   lastReqSlotNum_ = ret;
-   return ret;
+
+   // usedSlotNum_ follows the active table
+   activateSlotTable(cycleid);
+
+   // backlog, lower priority classes may drain over several cycles
+   float pkts = fArrivalPacketsAvg_;
+   float bytes = fArrivalBytesAvg_;
+   bool backlog = bHasPendingDownstreamQueueEntry_;
+   for (size_t c=0;c<downstreamQueue_.getNumClasses();c++) {
+      if (downstreamQueue_.getCurrentDepth(c)>0) backlog = true;
+      float cycles = CLASS_DRAIN_CYCLES[std::min(c,sizeof(CLASS_DRAIN_CYCLES)/sizeof(CLASS_DRAIN_CYCLES[0])-1)];
+      pkts += downstreamQueue_.getCurrentDepth(c) / cycles;
+      bytes += downstreamQueue_.getCurrentBytes(c) / cycles;
+   }
+   if (bHasPendingDownstreamQueueEntry_) {
+      pkts += 1;
+      bytes += pendingDownstreamQueueEntry_.pkt_.length();
+   }
+
+   // aggregation packs a slot, otherwise each packet takes a slot of its own
+   // and a packet larger than a slot is fragmented over several
+   float slotbytes = std::max<size_t>(timeslotByte_,1);
+   float need = (bytes + pkts*macheaderlen_) / slotbytes;
+   if (!aggregationEnable_) need = std::max(need, pkts);
+
+   int ret = static_cast<int>(std::ceil(need - REQUEST_SLOT_SLACK));
+   if (ret<0) ret = 0;
+   if (ret>(slotNumInCycle_/2+1)) ret = slotNumInCycle_/2+1;
+   // never give up the last slot while anything is still queued
+   if (backlog && ret<1) ret = 1;
+
+   // grow at once
+   if (ret >= lastReqSlotNum_) {
+      shrinkSlotNum_ = -1;
+      if (ret == lastReqSlotNum_) return -1;	// no req required
+      lastReqSlotNum_ = ret;
+      return ret;
+   }
+
+   // shrink only once the demand stayed lower for SHRINK_HOLD_CYCLES, and
+   // only down to the most it needed meanwhile, so requests do not oscillate
+   if (shrinkSlotNum_ < 0) {
+      u64ShrinkCycle_ = cycleid;
+      shrinkSlotNum_ = ret;
+   }
+   else shrinkSlotNum_ = std::max<int>(shrinkSlotNum_, ret);
+   if (cycleid - u64ShrinkCycle_ < SHRINK_HOLD_CYCLES) return -1;
+   lastReqSlotNum_ = shrinkSlotNum_;
+   shrinkSlotNum_ = -1;
+   return lastReqSlotNum_;
 }
 
 bool 
 EMANE::Models::TDMA::MACLayer::dynamicSlot(TimePoint)
 {
     int needslotn = getSynSlotNum();
-    if (needslotn>=0) {
+    if (needslotn>=0 && distributedSlots_) {
+      // keep one slot to come back from, like a FREE the manager has not reassigned
+      claimSlots(std::max(needslotn,1));
+    }
+    else if (needslotn>=0) {
       if (needslotn>0) {
 	EMANE::Models::TDMA::TdmaREvent event(id_,EMANE::Models::TDMA::TDMA_TYPE_REQ_SLOT,
 		"",macsubid_,needslotn,dynamicLen_);
@@ -1701,7 +1962,7 @@ EMANE::Models::TDMA::MACLayer::handleDownstreamQueueEntry(TimePoint sot)
   // previous end-of-transmission time
   TimePoint now = Clock::now();
   // if not the owner of current timeslot, wait to next timeslot
-  std::uint64_t nowus = (now).time_since_epoch().count()+50;
+  std::uint64_t nowus = getScheduleTime(now)+50;
   std::uint64_t cycleid = (nowus - tdmaBaseTime_)/(dynamicLen_+timeSlotLen_*slotNumInCycle_);
   std::uint64_t timeincycle = (nowus - tdmaBaseTime_)%(dynamicLen_+timeSlotLen_*slotNumInCycle_);
 
@@ -1718,6 +1979,8 @@ EMANE::Models::TDMA::MACLayer::handleDownstreamQueueEntry(TimePoint sot)
     return true;
   }
 
+  activateSlotTable(cycleid);
+
   int currSlotId = (timeincycle-dynamicLen_)%slotNumInCycle_;
   std::uint64_t slotid = cycleid*slotNumInCycle_+currSlotId;	
 
@@ -1725,7 +1988,7 @@ EMANE::Models::TDMA::MACLayer::handleDownstreamQueueEntry(TimePoint sot)
   std::uint64_t tonextus = cycleid*(dynamicLen_+timeSlotLen_*slotNumInCycle_)+timeSlotLen_*(currSlotId+1) - (nowus-tdmaBaseTime_);
 
   std::chrono::microseconds tonext(tonextus);
-  if (id_ != slot_map_[currSlotId] || (sendatbeginning_ && begin_send_ == slotid) || (slot_send_ == slotid)) {
+  if (!pActiveSlotTable_->isOwned(currSlotId) || (sendatbeginning_ && begin_send_ == slotid) || (slot_send_ == slotid)) {
     TimePoint nextry{now + tonext};
 
           downstreamQueueTimedEventId_ = 
@@ -1810,6 +2073,8 @@ EMANE::Models::TDMA::MACLayer::handleDownstreamQueueEntry(TimePoint sot)
 		    EMANE::DownstreamPacket newPkt1(info, buffer1, newpktsize);
 		    EMANE::DownstreamPacket newPkt2(info, buffer2, restsize);
 		    mac.incFrag();
+		    // the first fragment tells the receiver how much to reserve for reassembly
+		    if (firstTime) mac.setTotal(newpktsize+restsize);
   		    DownstreamQueueEntry entry1{newPkt1,                   // pkt
       			pendingDownstreamQueueEntry_.u64SequenceNumber_,  // sequence number
       			pendingDownstreamQueueEntry_.acquireTime_,             // acquire time
@@ -1868,7 +2133,6 @@ EMANE::Models::TDMA::MACLayer::handleDownstreamQueueEntry(TimePoint sot)
       else {
 	Microseconds tvAva {first_in_slot?(timeSlotLen_):(tonextus)};
 	Microseconds duration = getDurationMicroseconds(pktsize+macheaderlen_,getDataRate(pendingDownstreamQueueEntry_.datarate_));
-        pendingDownstreamQueueEntry_.durationMicroseconds_ = duration;
 
 	if (tvAva < guardTime_ || duration > (tvAva - guardTime_)) {
 	    // not enough time
@@ -1884,15 +2148,23 @@ EMANE::Models::TDMA::MACLayer::handleDownstreamQueueEntry(TimePoint sot)
 	}
       }
 
-      Serialization serialization{mac.serialize()};
+      // airtime covers the real payload plus the emulated header, neither the
+      // adjusted bytes nor the emulated header padding are sent over the air
+      pendingDownstreamQueueEntry_.durationMicroseconds_ =
+        getDurationMicroseconds(getPktSize(pendingDownstreamQueueEntry_.pkt_,mac.getFlag())+macheaderlen_,
+                                getDataRate(pendingDownstreamQueueEntry_.datarate_));
+
+      std::uint8_t header[MACHeaderLayout::SIZE];
+
+      size_t headerLen{mac.encode(header)};
 
       auto & pkt = pendingDownstreamQueueEntry_.pkt_;
       
       // prepend mac header to outgoing packet
-       pkt.prepend(serialization.c_str(), serialization.size());
+       pkt.prepend(header, headerLen);
 
        // next prepend the serialization length
-       pkt.prependLengthPrefixFraming(serialization.size());
+       pkt.prependLengthPrefixFraming(headerLen);
        
        commonLayerStatistics_.processOutbound(pkt, 
                                               std::chrono::duration_cast<Microseconds>(now - pendingDownstreamQueueEntry_.acquireTime_));
@@ -1956,7 +2228,7 @@ EMANE::Models::TDMA::MACLayer::handleDownstreamQueueEntry(TimePoint sot)
 							// no more pkt to send
 							if (dynamic_) {
   							    TimePoint nowx = Clock::now();
-							    std::uint64_t nowus = (nowx).time_since_epoch().count();
+							    std::uint64_t nowus = getScheduleTime(nowx);
 							    std::uint64_t cycleid = (nowus - tdmaBaseTime_)/(dynamicLen_+timeSlotLen_*slotNumInCycle_);
 							    if (last_dyn_cycid_ != cycleid) {
 								last_dyn_cycid_ = cycleid;
@@ -2009,8 +2281,9 @@ EMANE::Models::TDMA::MACLayer::splitPkt(int totallen, Utils::VectorIO vio, void
 size_t
 EMANE::Models::TDMA::MACLayer::getPktSize(EMANE::DownstreamPacket & pkt,std::uint8_t fragflag)
 {
+   // the adjustment applies to whole packets and to the first fragment only
    size_t x = (pkt.length()>payloadadjustlen_)?(pkt.length()-payloadadjustlen_):0;
-   return (fragflag<1?x:pkt.length());
+   return (fragflag<=1?x:pkt.length());
 }
 
 size_t 
@@ -2044,7 +2317,8 @@ EMANE::Models::TDMA::MACLayer::getJitter()
 {
   if(fJitterSeconds_ > 0.0f)
     {
-      return std::chrono::duration_cast<Microseconds>(DoubleSeconds{(*pRNDJitter_)()});
+      // +/- half the jitter range
+      return std::chrono::duration_cast<Microseconds>(DoubleSeconds{(rndJitter_.uniform() - 0.5f) * fJitterSeconds_});
     }
   else
     {
@@ -2067,14 +2341,473 @@ EMANE::Models::TDMA::MACLayer::getDataRate(std::uint8_t rateIdx)
   return dataratebps_[rateIdx-1];	
 }
 
+std::pair<double,bool>
+EMANE::Models::TDMA::MACLayer::getNoiseFloor(const FrequencySegment & frequencySegment,
+                                             const Microseconds & span,
+                                             const TimePoint & startOfReception)
+{
+  const std::uint64_t u64FrequencyHz{frequencySegment.getFrequencyHz()};
+
+  auto iter = flushSpans_.find(u64FrequencyHz);
+
+  if(iter != flushSpans_.end())
+    {
+      auto window = flushWindows_.find(u64FrequencyHz);
+
+      // one request for every reception of the slot on this frequency
+      if(window == flushWindows_.end())
+        {
+          window = flushWindows_.insert(std::make_pair(u64FrequencyHz,
+                                                       pRadioService_->spectrumService().request(u64FrequencyHz,
+                                                                                                 std::chrono::duration_cast<Microseconds>(iter->second.second - iter->second.first),
+                                                                                                 iter->second.first))).first;
+        }
+
+      return Utils::maxBinNoiseFloorRange(window->second,
+                                          frequencySegment.getRxPowerdBm(),
+                                          startOfReception,
+                                          startOfReception + span);
+    }
+
+  auto window = pRadioService_->spectrumService().request(u64FrequencyHz,
+                                                          span,
+                                                          startOfReception);
+
+  return Utils::maxBinNoiseFloor(window, frequencySegment.getRxPowerdBm());
+}
+
+bool
+EMANE::Models::TDMA::MACLayer::queueReception(Reception & reception)
+{
+  const std::uint64_t u64FrequencyHz{reception.frequencySegments_.begin()->getFrequencyHz()};
+  const TimePoint & startOfReception{reception.startOfReception_};
+  const Microseconds & span{reception.span_};
+
+  const std::uint64_t cycleLen{dynamicLen_ + timeSlotLen_ * slotNumInCycle_};
+
+  if(!tdmaReady_ || !timeSlotLen_ || !cycleLen)
+    {
+      return false;
+    }
+
+  const TimePoint eor{startOfReception + span};
+
+  // end of the slot, or of the dynamic part, that the reception ends in
+  const std::uint64_t eorus = getScheduleTime(eor);
+  const std::uint64_t offset = (eorus - tdmaBaseTime_) % cycleLen;
+  const std::uint64_t remain = offset < timeSlotLen_ * slotNumInCycle_ ?
+    timeSlotLen_ - offset % timeSlotLen_ : cycleLen - offset;
+
+  const TimePoint slotEnd{eor + Microseconds(remain)};
+
+  if(slotEnd <= Clock::now())
+    {
+      return false;
+    }
+
+  // a reception of a later slot, the pending one is over
+  if(!batchReceptions_.empty() && slotEnd != batchFlushTime_)
+    {
+      flushReceptions();
+    }
+
+  if(batchReceptions_.empty())
+    {
+      batchFlushTime_ = slotEnd;
+
+      const std::uint64_t u64Generation{u64BatchGeneration_};
+
+      pPlatformService_->timerService().
+        scheduleTimedEvent(slotEnd,
+                           new std::function<bool()>{[this, u64Generation]()
+                               {
+                                 // already flushed by a later slot
+                                 if(u64Generation == u64BatchGeneration_)
+                                   {
+                                     flushReceptions();
+                                   }
+
+                                 return true;
+                               }});
+    }
+
+  auto iter = batchSpans_.find(u64FrequencyHz);
+
+  if(iter == batchSpans_.end())
+    {
+      batchSpans_.insert(std::make_pair(u64FrequencyHz, std::make_pair(startOfReception, eor)));
+    }
+  else
+    {
+      iter->second.first = std::min(iter->second.first, startOfReception);
+      iter->second.second = std::max(iter->second.second, eor);
+    }
+
+  batchReceptions_.push_back(std::move(reception));
+
+  return true;
+}
+
+void
+EMANE::Models::TDMA::MACLayer::flushReceptions()
+{
+  std::vector<Reception> receptions;
+
+  receptions.swap(batchReceptions_);
+
+  flushSpans_.swap(batchSpans_);
+
+  ++u64BatchGeneration_;
+
+  processReceptions(receptions.data(), receptions.size());
+
+  flushSpans_.clear();
+  flushWindows_.clear();
+}
+
+void
+EMANE::Models::TDMA::MACLayer::processReceptions(Reception * pReceptions, size_t count)
+{
+  batchSINR_.clear();
+  batchLength_.clear();
+  batchDataRate_.clear();
+  batchIndex_.clear();
+
+  for(size_t i = 0; i < count; ++i)
+    {
+      if(measureReception(pReceptions[i]))
+        {
+          batchSINR_.push_back(pReceptions[i].dSINR_);
+          batchLength_.push_back(pReceptions[i].pkt_.length());
+          batchDataRate_.push_back(pReceptions[i].datarate_);
+          batchIndex_.push_back(i);
+        }
+    }
+
+  const size_t measured{batchIndex_.size()};
+
+  batchPOR_.resize(measured);
+  batchRandom_.resize(measured);
+
+  // check each sinr against the curve of the rate its sender used, the
+  // draws are taken in reception order as checkPOR takes them
+  pcrManager_.getPCR(batchSINR_.data(),
+                     batchLength_.data(),
+                     batchDataRate_.data(),
+                     batchPOR_.data(),
+                     measured);
+
+  rndReception_.uniform(batchRandom_.data(), measured);
+
+  for(size_t i = 0; i < measured; ++i)
+    {
+      // pcr >= random value
+      const bool bReceived{batchPOR_[i] >= batchRandom_[i]};
+
+      LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
+                             DEBUG_LEVEL,
+                             "MACI %03hu %s::%s: sinr %3.2f, pcr %3.2f %s rand %3.3f",
+                             id_,
+                             pzLayerName,
+                             __func__,
+                             batchSINR_[i],
+                             batchPOR_[i],
+                             bReceived ? ">=" : "<",
+                             batchRandom_[i]);
+
+      completeReception(pReceptions[batchIndex_[i]], bReceived);
+    }
+}
+
+bool
+EMANE::Models::TDMA::MACLayer::measureReception(Reception & reception)
+{
+  UpstreamPacket & pkt{reception.pkt_};
+
+  const PacketInfo & pktInfo{pkt.getPacketInfo()};
+
+  const FrequencySegment & frequencySegment{*reception.frequencySegments_.begin()};
+
+  LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
+                         DEBUG_LEVEL,
+                         "MACI %03hu %s upstream EOR processing: src %hu, dst %hu,"
+                         " len %zu, freq %ju, offset %ju, duration %ju, mac sequence %ju",
+                         id_,
+                         pzLayerName,
+                         pktInfo.getSource(),
+                         pktInfo.getDestination(),
+                         pkt.length(),
+                         frequencySegment.getFrequencyHz(),
+                         frequencySegment.getOffset().count(),
+                         frequencySegment.getDuration().count(),
+                         reception.u64SequenceNumber_);
+
+  try
+    {
+      // [spectrumservice-request-snibbet] /
+      // For simple noise processing we will just pull out the max noise segment
+      // over the span of the reception, see getNoiseFloor.
+      bool bSignalInNoise{};
+
+      std::tie(reception.dNoiseFloordB_,bSignalInNoise) =
+        getNoiseFloor(frequencySegment, reception.span_, reception.startOfReception_);
+
+      reception.dSINR_ = frequencySegment.getRxPowerdBm() - reception.dNoiseFloordB_;
+      // [spectrumservice-request-snibbet] /
+
+      LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
+                             DEBUG_LEVEL,
+                             "MACI %03hu %s upstream EOR processing: src %hu, dst %hu, max noise %f, signal in noise %s, SINR %f",
+                             id_,
+                             pzLayerName,
+                             pktInfo.getSource(),
+                             pktInfo.getDestination(),
+                             reception.dNoiseFloordB_,
+                             bSignalInNoise ? "yes" : "no",
+                             reception.dSINR_);
+    }
+  catch(SpectrumServiceException & exp)
+    {
+      LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
+                             ERROR_LEVEL,
+                             "MACI %03hu %s upstream EOR processing: src %hu, dst %hu, sor %ju, span %ju spectrum service request error: %s",
+                             id_,
+                             pzLayerName,
+                             pktInfo.getSource(),
+                             pktInfo.getDestination(),
+                             std::chrono::duration_cast<Microseconds>(reception.startOfReception_.time_since_epoch()).count(),
+                             reception.span_.count(),
+                             exp.what());
+
+      commonLayerStatistics_.processOutbound(pkt,
+                                             std::chrono::duration_cast<Microseconds>(Clock::now() - reception.beginTime_),
+                                             DROP_CODE_BAD_SPECTRUM_QUERY);
+      // drop
+      return false;
+    }
+
+  // sinr for the overheard packets that are not sampled
+  if(!bPromiscuousMode_ &&
+     pktInfo.getDestination() != id_ &&
+     pktInfo.getDestination() != NEM_BROADCAST_MAC_ADDRESS)
+    {
+      overheardSINR_[pktInfo.getSource()] = std::make_pair(reception.dSINR_, reception.dNoiseFloordB_);
+    }
+
+  return true;
+}
+
+void
+EMANE::Models::TDMA::MACLayer::completeReception(Reception & reception, bool bReceived)
+{
+  UpstreamPacket & pkt{reception.pkt_};
+
+  const PacketInfo & pktInfo{pkt.getPacketInfo()};
+
+  const FrequencySegment & frequencySegment{*reception.frequencySegments_.begin()};
+
+  if(!bReceived)
+    {
+      LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
+                             DEBUG_LEVEL,
+                             "MACI %03hu %s upstream EOR processing: src %hu, dst %hu, "
+                             "rxpwr %3.2f dBm, drop",
+                             id_,
+                             pzLayerName,
+                             pktInfo.getSource(),
+                             pktInfo.getDestination(),
+                             frequencySegment.getRxPowerdBm());
+
+      commonLayerStatistics_.processOutbound(pkt,
+                                             std::chrono::duration_cast<Microseconds>(Clock::now() - reception.beginTime_),
+                                             DROP_CODE_SINR);
+
+      // drop
+      return;
+    }
+
+  // update neighbor metrics
+  neighborMetricManager_.updateNeighborRxMetric(pktInfo.getSource(),            // nbr (src)
+                                                reception.u64SequenceNumber_,   // sequence number
+                                                pktInfo.getUUID(),
+                                                reception.dSINR_,               // sinr in dBm
+                                                reception.dNoiseFloordB_,       // noise floor in dB
+                                                reception.startOfReception_,    // rx time
+                                                frequencySegment.getDuration(), // duration
+                                                reception.u64DataRate_);        // data rate bps
+
+  // check promiscuous mode, destination is this nem or to all nem's
+  if(bPromiscuousMode_ ||
+     (pktInfo.getDestination() == id_) ||
+     (pktInfo.getDestination() == NEM_BROADCAST_MAC_ADDRESS))
+    {
+      LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
+                             DEBUG_LEVEL,
+                             "MACI %03hu %s upstream EOR processing: src %hu, dst %hu, forward upstream   len %d",
+                             id_,
+                             pzLayerName,
+                             pktInfo.getSource(),
+                             pktInfo.getDestination(),
+                             pkt.length());
+
+      commonLayerStatistics_.processOutbound(pkt,
+                                             std::chrono::duration_cast<Microseconds>(Clock::now() - reception.beginTime_));
+
+      MACHeaderMessage tdmaMACHeader(reception.sequence_,reception.fragment_,reception.datarate_,reception.len_);
+      if (tdmaMACHeader.isFragment()) {
+        LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
+                               DEBUG_LEVEL,
+                               "MACI FRAG %03hu %s origin %hu, dst %hu, len %zu fseq: %d",
+                               id_,
+                               pzLayerName,
+                               pktInfo.getSource(),
+                               pktInfo.getDestination(),
+                               pkt.length(),
+                               tdmaMACHeader.getFlag());
+        struct MacHeader mh;
+        mh.sequence = tdmaMACHeader.getSequence(); mh.fragflag = tdmaMACHeader.getFlag();
+        mh.datarate = tdmaMACHeader.getDataRate(); mh.len = tdmaMACHeader.getLen();
+        mh.total = reception.total_;
+        EMANE::UpstreamPacket fpkt = fragmentManager_.process(pkt,pkt.getPacketInfo(),&mh);
+        if (fpkt.length()>0) {
+          queueUpstream(std::move(fpkt));
+        }
+      }
+      else {
+        queueUpstream(std::move(pkt));
+      }
+    }
+  else
+    {
+      LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
+                             DEBUG_LEVEL,
+                             "MACI %03hu %s upstream EOR processing: not for this nem, "
+                             "ignore pkt src %hu, dst %hu, drop",
+                             id_,
+                             pzLayerName,
+                             pktInfo.getSource(),
+                             pktInfo.getDestination());
+
+      commonLayerStatistics_.processOutbound(pkt,
+                                             std::chrono::duration_cast<Microseconds>(Clock::now() - reception.beginTime_),
+                                             DROP_CODE_DST_MAC);
+    }
+}
+
+void
+EMANE::Models::TDMA::MACLayer::queueEOR(const TimePoint & eor, Reception && reception)
+{
+  eorReceptions_.insert(std::make_pair(eor, std::move(reception)));
+
+  // the armed timer serves it too unless it ends earlier
+  if(!bEORTimerArmed_ || eor < eorTimerTime_)
+    {
+      armEORTimer(eor);
+    }
+}
+
+void
+EMANE::Models::TDMA::MACLayer::armEORTimer(const TimePoint & eor)
+{
+  eorTimerTime_ = eor;
+  bEORTimerArmed_ = true;
+
+  pPlatformService_->timerService().
+    scheduleTimedEvent(eor,
+                       new std::function<bool()>{[this, eor]()
+                           {
+                             processDueReceptions(eor);
+
+                             return true;
+                           }});
+}
+
+void
+EMANE::Models::TDMA::MACLayer::processDueReceptions(const TimePoint & timerTime)
+{
+  // an earlier reception may have armed a timer after this one
+  if(bEORTimerArmed_ && timerTime == eorTimerTime_)
+    {
+      bEORTimerArmed_ = false;
+    }
+
+  // everything ended by now, however many timers it would have taken
+  auto end = eorReceptions_.upper_bound(Clock::now());
+
+  for(auto iter = eorReceptions_.begin(); iter != end; ++iter)
+    {
+      dueReceptions_.push_back(std::move(iter->second));
+    }
+
+  eorReceptions_.erase(eorReceptions_.begin(), end);
+
+  processReceptions(dueReceptions_.data(), dueReceptions_.size());
+
+  dueReceptions_.clear();
+
+  if(!eorReceptions_.empty() &&
+     (!bEORTimerArmed_ || eorReceptions_.begin()->first < eorTimerTime_))
+    {
+      armEORTimer(eorReceptions_.begin()->first);
+    }
+}
+
+void
+EMANE::Models::TDMA::MACLayer::queueUpstream(UpstreamPacket && pkt)
+{
+  upstreamQueue_.push_back(std::move(pkt));
+}
+
+void
+EMANE::Models::TDMA::MACLayer::deliverUpstream()
+{
+  if(upstreamQueue_.empty())
+    {
+      return;
+    }
+
+  std::vector<UpstreamPacket> packets;
+
+  packets.swap(upstreamQueue_);
+
+  for(auto & pkt : packets)
+    {
+      sendUpstreamPacket(pkt);
+    }
+
+  // keep the capacity for the next tick
+  if(upstreamQueue_.empty())
+    {
+      packets.clear();
+
+      packets.swap(upstreamQueue_);
+    }
+}
+
+bool
+EMANE::Models::TDMA::MACLayer::sampleOverheard(NEMId src)
+{
+  // spread the samples evenly, a source never measured is always sampled
+  fOverheardCredit_ += fOverheardSampleRate_;
+
+  if(fOverheardCredit_ >= 1.0f || overheardSINR_.find(src) == overheardSINR_.end())
+    {
+      fOverheardCredit_ = std::max(fOverheardCredit_ - 1.0f, 0.0f);
+
+      return true;
+    }
+
+  return false;
+}
+
 bool 
 EMANE::Models::TDMA::MACLayer::checkPOR(float fSINR, size_t packetSize, std::uint16_t dataRateIndex)
 {
   // find por
   float fPCR{pcrManager_.getPCR(fSINR, packetSize, dataRateIndex)};
 
-  // get random value [0.0, 1.0]
-  float fRandomValue{RNDZeroToOne_()};
+  // get random value (0.0, 1.0]
+  float fRandomValue{rndReception_.uniform()};
 
   // pcr >= random value
   bool bResult{fPCR >= fRandomValue};
@@ -2117,8 +2850,10 @@ EMANE::Models::TDMA::MACLayer::processTimedEvent(TimerEventId tid,
         {
           delete pCallBack;
         }
+
+      deliverUpstream();
    }
-   else tdmaManager_->processTimedEvent(tid,a,b,c,arg);
+   else if (pManager_ != NULL) pManager_->processTimedEvent(tid,a,b,c,arg);
 }
 
 void 
@@ -2126,16 +2861,17 @@ EMANE::Models::TDMA::MACLayer::proxyEvent (NEMId from, NEMId nemId, Event &event
 {
   pPlatformService_->eventService().sendEvent(nemId,event);
 
-  if (id_ == tdmaManager_->getPid()) {
+  if (pManager_ != NULL && id_ == pManager_->getPid()) {
     if (from==0) {
 	// tdma manager
 	if (event.getEventId() == EMANE::Models::TDMA::TdmaBEvent::IDENTIFIER)
 		processEvent(event.getEventId(),event.serialize());
+	else if (event.getEventId() == EMANE::Models::TDMA::TdmaREvent::IDENTIFIER &&
+		 static_cast<EMANE::Models::TDMA::TdmaREvent &>(event).getType() == EMANE::Models::TDMA::TDMA_TYPE_NOTIFY)
+		joinManager(static_cast<EMANE::Models::TDMA::TdmaREvent &>(event).getUuid());
     }
     else {
-	mgrLock_.lock();
-	tdmaManager_->processEventTDMA(event.getEventId(),event.serialize());
-	mgrLock_.unlock();
+	pManager_->processEventTDMA(event.getEventId(),event.serialize());
     }
   }
 }
@@ -2157,34 +2893,97 @@ EMANE::Models::TDMA::MACLayer::processEvent(const EventId & eventId,
   switch(eventId)
     {
     case EMANE::Models::TDMA::TdmaREvent::IDENTIFIER:
-	// this is only for tdma manager
+	// this is mostly for tdma manager
       {
-	if (tdmaManager_!=NULL) {
-	   if (id_ == tdmaManager_->getPid()) {
-		mgrLock_.lock();
-		tdmaManager_->processEventTDMA(eventId,serialization);
-		mgrLock_.unlock();
+	EMANE::Models::TDMA::TdmaREvent revent(serialization);
+	if (distributedSlots_) {
+	    if (revent.getType() == EMANE::Models::TDMA::TDMA_TYPE_CLAIM &&
+		revent.getSubId() == macsubid_) {
+		NEMId nemId = revent.getEventSource();
+		TimePoint now{Clock::now()};
+		// stale claims do not take part in the owners
+		bool changed = slotClaims_.expire(now - getClaimPeriod()*CLAIM_EXPIRY_PERIODS);
+		// a NEM new to us has not heard our claim either
+		bool known = slotClaims_.isKnown(nemId);
+		if (slotClaims_.update(nemId,revent.getSlots(),now)) changed = true;
+		if (slotClaims_.claim(claimWant_) || !known)
+		    sendClaim();
+		if (changed)
+		    scheduleClaimedSlots();
+	    }
+	    break;
+	}
+	// a manager was elected, join it
+	if (revent.getType() == EMANE::Models::TDMA::TDMA_TYPE_NOTIFY)
+	    joinManager(revent.getUuid());
+
+	if (pManager_!=NULL) {
+	   if (id_ == pManager_->getPid()) {
+		pManager_->processEventTDMA(eventId,serialization);
 	   }
 	}
       }
       break;
     case EMANE::Models::TDMA::TdmaBEvent::IDENTIFIER:
       {
+	bool missed = false;
 	eventLock_.lock();
 	EMANE::Models::TDMA::TdmaBEvent bevent(serialization);
 	if (bevent.getSubId() == macsubid_) {
-	    const SlotMap & slotmap = bevent.getSlotmap();
 	    std::uint64_t slotbt = bevent.getSlot0time();
+	    bool applied = true;
+
+	    // built aside, the active table is untouched until activation
+	    if (!bevent.isDelta()) {
+		pPendingSlotTable_->load(bevent);
+		bAwaitingSnapshot_ = false;
+	    }
+	    else if (bAwaitingSnapshot_) {
+		// the snapshot asked for replaces whatever these would change
+		applied = false;
+	    }
+	    else if (slotMapVersion_ != 0 && bevent.getBaseVersion() == slotMapVersion_) {
+		// the base is the newest map, pending if one is waiting
+		if (!bHasPendingSlotTable_) *pPendingSlotTable_ = *pActiveSlotTable_;
+		for (const auto & change : bevent.getChanges()) {
+		    pPendingSlotTable_->setOwner(change.first, change.second);
+		}
+	    }
+	    else {
+		// a version was missed, ask for a full snapshot once per gap
+		applied = false;
+		missed = true;
+		bAwaitingSnapshot_ = true;
+	    }
 
-	    usedSlotNum_ = 0;
-	    for (size_t i=0;i<slotmap.size();i++) {
-		slot_map_[i] = slotmap[i];
-		if (slot_map_[i] == id_) usedSlotNum_++;
+	    if (applied) {
+		slotMapVersion_ = bevent.getVersion();
+		tdmaBaseTime_ = slotbt;
+		std::uint64_t activation = bevent.getActivationCycle();
+		if (activation == 0 && tdmaReady_) {
+		    // switch at our next cycle, or with the map already waiting
+		    std::uint64_t nowus = getScheduleTime(Clock::now());
+		    activation = (nowus - tdmaBaseTime_)/(dynamicLen_+timeSlotLen_*slotNumInCycle_) + 1;
+		    if (bHasPendingSlotTable_) activation = std::max(activation, pendingSlotCycle_);
+		}
+		pendingSlotCycle_ = activation;
+		bHasPendingSlotTable_ = true;
+		// nothing to keep in step with before the first map
+		if (!tdmaReady_) {
+		    std::swap(pActiveSlotTable_, pPendingSlotTable_);
+		    bHasPendingSlotTable_ = false;
+		    usedSlotNum_ = pActiveSlotTable_->getOwnedCount();
+		}
+		tdmaReady_ = true;
 	    }
-	    tdmaBaseTime_ = slotbt;
-	    tdmaReady_ = true;
 	}
 	eventLock_.unlock();
+
+	if (missed) {
+	    EMANE::Models::TDMA::TdmaREvent event(id_,EMANE::Models::TDMA::TDMA_TYPE_REQ_MAP,
+		"",macsubid_,slotNumInCycle_,0);
+	    proxyEvent(id_,0,event);
+	}
       }
       break;
     }
@@ -43,18 +43,24 @@
 #include "emane/events/location.h"
 #include "emane/events/locationevent.h"
 #include "emane/position.h"
+#include "emane/spectrumserviceprovider.h"
+#include "emane/frequencysegment.h"
 #include "emane/orientation.h"
 #include "emane/velocity.h"
 
 #include "emane/utils/runningaverage.h"
-#include "emane/utils/randomnumberdistribution.h"
 #include "emane/utils/commonlayerstatistics.h"
 
 #include "tdmaevent.h"
 #include "downstreamqueue.h"
 #include "pcrmanager.h"
 #include "fragmentmgr.h"
+#include "slottable.h"
+#include "slotclaims.h"
+#include "randomstream.h"
 
+#include <atomic>
+#include <map>
 #include <memory>
 #include <netinet/ip.h>
 #include "tdmamanager.h"
@@ -132,6 +138,26 @@ namespace EMANE
          */
         static const RegistrationId type_ = REGISTERED_EMANE_MAC_TDMA;
 
+	// a received packet waiting for its end of reception, sinr and
+	// noise floor are filled in when it is measured
+	struct Reception
+	{
+	    UpstreamPacket pkt_;
+	    TimePoint startOfReception_;
+	    FrequencySegments frequencySegments_;
+	    Microseconds span_;
+	    TimePoint beginTime_;
+	    std::uint64_t u64SequenceNumber_;
+	    std::uint64_t u64DataRate_;
+	    std::uint8_t sequence_;
+	    std::uint8_t fragment_;
+	    std::uint8_t datarate_;
+	    std::uint8_t len_;
+	    std::uint16_t total_;
+	    double dSINR_;
+	    double dNoiseFloordB_;
+	};
+
         std::uint64_t 		u64TxSequenceNumber_;
         FlowControlManager 	flowControlManager_;
         PCRManager		pcrManager_;
@@ -139,11 +165,10 @@ namespace EMANE
         QueueMetricManager 	queueMetricManager_;
         StatisticNumeric<std::uint64_t> * pNumDownstreamQueueDelay_;
         TimerEventId radioMetricTimedEventId_;
+        TimerEventId claimTimedEventId_;
         Utils::CommonLayerStatistics 		commonLayerStatistics_;
-        Utils::RandomNumberDistribution<std::mt19937, 
-                                 std::uniform_real_distribution<float>> RNDZeroToOne_;
-        std::unique_ptr<Utils::RandomNumberDistribution<std::mt19937, 
-                                 std::uniform_real_distribution<float>>> pRNDJitter_;
+        RandomStream rndReception_;
+        RandomStream rndJitter_;
         TimerEventId downstreamQueueTimedEventId_;
         bool 		bHasPendingDownstreamQueueEntry_;
         DownstreamQueueEntry pendingDownstreamQueueEntry_;
@@ -158,7 +183,13 @@ namespace EMANE
 	bool		dynamic_;
 	std::uint64_t	tdmaBaseTime_;
   	char 		priority_[64];
-	NEMId		slot_map_[256];
+	SlotTable	slotTables_[2];
+	SlotTable *	pActiveSlotTable_;	// the slots we transmit in
+	SlotTable *	pPendingSlotTable_;	// newest map, waits for its cycle
+	std::atomic<bool> bHasPendingSlotTable_;
+	std::uint64_t	pendingSlotCycle_;
+	SlotClaims	slotClaims_;		// distributed mode only
+	std::uint16_t	claimWant_;
 	std::uint64_t	begin_send_;
 	std::uint64_t	slot_send_;
 	std::uint8_t	sequence_;
@@ -166,11 +197,53 @@ namespace EMANE
   	size_t   	timeslotByte_;   
 
 	std::uint16_t	lastReqSlotNum_;
+	int		shrinkSlotNum_;		// lower demand held since u64ShrinkCycle_, -1 if none
+	std::uint64_t	u64ShrinkCycle_;
+	std::uint64_t	u64ArrivedPackets_;
+	std::uint64_t	u64ArrivedBytes_;
+	std::uint64_t	u64DemandPackets_;	// arrivals already averaged
+	std::uint64_t	u64DemandBytes_;
+	std::uint64_t	u64DemandCycle_;
+	float		fArrivalPacketsAvg_;	// per cycle
+	float		fArrivalBytesAvg_;
 	std::uint16_t	usedSlotNum_;
+	std::uint32_t	slotMapVersion_;
+	bool		bAwaitingSnapshot_;	// REQ_MAP sent, deltas dropped until a full map
 	std::uint64_t	last_dyn_cycid_;
+	NeighborList	reportedNeighbors_;
+	bool		neighborsReported_;
+	std::string	managerUuid_;		// manager our NEMINIT went to
+	float		fOverheardCredit_;
+	std::map<NEMId,std::pair<double,double>> overheardSINR_;	// sinr, noise floor
+
+	// receptions ending in one slot, processed together at its end
+	std::vector<Reception> batchReceptions_;
+	std::map<std::uint64_t,std::pair<TimePoint,TimePoint>> batchSpans_;	// by frequency
+	std::map<std::uint64_t,std::pair<TimePoint,TimePoint>> flushSpans_;	// batch being processed
+	std::map<std::uint64_t,SpectrumWindow> flushWindows_;
+	TimePoint	batchFlushTime_;
+	std::uint64_t	u64BatchGeneration_;
+
+	// per reception inputs and results of a batch reception decision
+	std::vector<float> batchSINR_;
+	std::vector<size_t> batchLength_;
+	std::vector<std::uint16_t> batchDataRate_;
+	std::vector<float> batchPOR_;
+	std::vector<float> batchRandom_;
+	std::vector<size_t> batchIndex_;
+
+	// receptions by end of reception, one timer armed for the earliest,
+	// everything due when it fires is processed as one batch
+	std::multimap<TimePoint,Reception> eorReceptions_;
+	std::vector<Reception> dueReceptions_;
+	TimePoint	eorTimerTime_;
+	bool		bEORTimerArmed_;
+
+	// packets completed during the current timer tick, sent upstream together
+	std::vector<UpstreamPacket> upstreamQueue_;
 
 	std::mutex eventLock_;
-	std::mutex mgrLock_;
+	TDMAManager * pManager_;	// owned by TDMAManagerRegistry
 
         // config items
         bool 		bPromiscuousMode_;
@@ -198,10 +271,36 @@ namespace EMANE
 	std::uint16_t   payloadadjustlen_;
 	Microseconds  	dynamicLength_;
 	std::uint64_t  	dynamicLen_;
+	bool		spatialReuse_;
+	bool		distributedSlots_;
+	float		fOverheardSampleRate_;
+	bool		bSpectrumBatch_;
 
 	// functions
 
 	bool sendInitRevent();
+	void joinManager(const std::string & uuid);
+	void activateSlotTable(std::uint64_t cycleid);
+	void sendClaim();
+	Microseconds getClaimPeriod() const;
+	void announceClaim();
+	void claimSlots(std::uint16_t want);
+	void scheduleClaimedSlots();
+	void reportNeighbors(const Controls::R2RINeighborMetrics & metrics);
+	bool sampleOverheard(NEMId src);
+	bool queueReception(Reception & reception);
+	void flushReceptions();
+	void processReceptions(Reception * pReceptions, size_t count);
+	void queueEOR(const TimePoint & eor, Reception && reception);
+	void armEORTimer(const TimePoint & eor);
+	void processDueReceptions(const TimePoint & timerTime);
+	bool measureReception(Reception & reception);
+	void completeReception(Reception & reception, bool bReceived);
+	void queueUpstream(UpstreamPacket && pkt);
+	void deliverUpstream();
+	std::pair<double,bool> getNoiseFloor(const FrequencySegment & frequencySegment,
+					     const Microseconds & span,
+					     const TimePoint & startOfReception);
 	std::uint16_t getDataRateIndex(std::uint64_t recvRatebps);
 	std::uint64_t getDataRate(std::uint8_t rateIdx);
 	size_t getTimeByte(std::uint64_t sendRatebps, EMANE::Microseconds tvLeftTime);
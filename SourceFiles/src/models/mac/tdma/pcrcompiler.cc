@@ -33,20 +33,38 @@
  * See toplevel COPYING for more information.
  */
 
-package EMANEMessage;
+/*
+ * Compiles a pcr curve xml file into the binary table format that
+ * PCRManager maps instead of parsing, use the output as pcrcurveuri.
+ */
+
+#include "pcrmanager.h"
+
+#include "emane/exception.h"
 
-option optimize_for = SPEED;
+#include <iostream>
 
-message TdmaMACHeader
+int main(int argc, char * argv[])
 {
-  required uint32 sequence = 1;
-  required uint32 flag = 2;
-  message resv
-  {
-    required uint32 byte = 1;
-  }
-
-  repeated resv datarate = 3;
-}
+  if(argc != 3)
+    {
+      std::cerr << "usage: " << argv[0] << " <pcr curve xml> <compiled output>" << std::endl;
+      return 1;
+    }
+
+  try
+    {
+      EMANE::Models::TDMA::PCRManager pcrManager{0, NULL};
 
+      pcrManager.load(argv[1]);
 
+      EMANE::Models::TDMA::savePCRBinary(*pcrManager.getTable(), argv[2]);
+    }
+  catch(EMANE::Exception & exp)
+    {
+      std::cerr << exp.what() << std::endl;
+      return 1;
+    }
+
+  return 0;
+}
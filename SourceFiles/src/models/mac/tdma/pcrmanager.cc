@@ -35,16 +35,16 @@
 #include "emane/utils/parameterconvert.h"
 
 #include "pcrmanager.h"
+#include "pcrmodel.h"
 
 #include <libxml/parser.h>
-#include <math.h>
 
 #include <sstream>
 
 
 namespace
 {
-  const int PRECISION_FACTOR{100};
+  const EMANE::Models::TDMA::PCRTable EMPTY_PCR_TABLE{};
 
   inline xmlChar * toXMLChar(const char * p)
    {
@@ -56,13 +56,26 @@ namespace
 EMANE::Models::TDMA::PCRManager::PCRManager(EMANE::NEMId id, EMANE::PlatformServiceProvider * pPlatformService):
 id_{id}, 
 pPlatformService_{pPlatformService}, 
-tablePacketSize_{}
+pTable_{},
+pendingLock_{},
+pPendingTable_{},
+bHasPendingTable_{},
+requestedUri_{},
+bHasRequest_{},
+bLoading_{},
+pendingLoad_{}
 { }
 
 
 
 EMANE::Models::TDMA::PCRManager::~PCRManager()
-{ }
+{
+  // the load thread refers to this
+  if(pendingLoad_.valid())
+    {
+      pendingLoad_.wait();
+    }
+}
 
 
 void
@@ -127,10 +140,6 @@ EMANE::Models::TDMA::PCRManager::closeDoc(xmlParserCtxtPtr * ppContext, xmlDoc *
 void
 EMANE::Models::TDMA::PCRManager::load(const std::string & uri)
 {
-  xmlDoc * doc{};
-  xmlNode * root{};
-  xmlParserCtxtPtr pContext{};
-
   if(uri.empty())
     {
       std::stringstream excString;
@@ -139,21 +148,139 @@ EMANE::Models::TDMA::PCRManager::load(const std::string & uri)
       throw EMANE::ConfigurationException(excString.str());
     }
 
+  pTable_ = build(uri);
+}
+
+
+
+void
+EMANE::Models::TDMA::PCRManager::reload(const std::string & uri)
+{
+  std::lock_guard<std::mutex> m(pendingLock_);
+
+  requestedUri_ = uri;
+
+  bHasRequest_ = true;
+
+  // the running load picks the request up when it is done
+  if(bLoading_)
+    {
+      return;
+    }
+
+  bLoading_ = true;
+
+  // the previous load has finished, it cleared bLoading_ on its way out
+  pendingLoad_ = std::async(std::launch::async, [this]() { loadRequested(); });
+}
+
+
+
+void
+EMANE::Models::TDMA::PCRManager::loadRequested()
+{
+  while(true)
+    {
+      std::string uri;
+
+      {
+        std::lock_guard<std::mutex> m(pendingLock_);
+
+        if(!bHasRequest_)
+          {
+            bLoading_ = false;
+            return;
+          }
+
+        uri = requestedUri_;
+
+        bHasRequest_ = false;
+      }
+
+      try
+        {
+          if(uri.empty())
+            {
+              throw EMANE::ConfigurationException("must supply curve file name");
+            }
+
+          std::shared_ptr<const PCRTable> pTable{build(uri)};
+
+          std::lock_guard<std::mutex> m(pendingLock_);
+
+          pPendingTable_ = pTable;
+
+          bHasPendingTable_.store(true, std::memory_order_release);
+
+          LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+                                  INFO_LEVEL,
+                                  "MACI %03hu PCRManager::reload: loaded %s",
+                                  id_,
+                                  uri.c_str());
+        }
+      catch(EMANE::Exception & exp)
+        {
+          LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+                                  ERROR_LEVEL,
+                                  "MACI %03hu PCRManager::reload: %s, keeping the current curves",
+                                  id_,
+                                  exp.what());
+        }
+    }
+}
+
+
+
+std::shared_ptr<const EMANE::Models::TDMA::PCRTable>
+EMANE::Models::TDMA::PCRManager::build(const std::string & uri)
+{
+  // compiled tables are mapped, anything else is parsed as xml
+  return PCRTableCache::instance().get(uri,
+                                       [this](const std::string & u)
+                                       {
+                                         return isPCRBinary(u) ? loadPCRBinary(u) : parse(u);
+                                       });
+}
+
+
+
+void
+EMANE::Models::TDMA::PCRManager::swapPendingTable()
+{
+  if(bHasPendingTable_.load(std::memory_order_acquire))
+    {
+      std::lock_guard<std::mutex> m(pendingLock_);
+
+      // the old table goes with its last reference
+      pTable_ = std::move(pPendingTable_);
+
+      bHasPendingTable_.store(false, std::memory_order_relaxed);
+    }
+}
+
+
+
+std::shared_ptr<EMANE::Models::TDMA::PCRTable>
+EMANE::Models::TDMA::PCRManager::parse(const std::string & uri)
+{
+  xmlDoc * doc{};
+  xmlNode * root{};
+  xmlParserCtxtPtr pContext{};
+
+  std::shared_ptr<PCRTable> pTable{new PCRTable{}};
+
   // open doc
   openDoc(uri, &pContext, &doc, &root);
 
   // root
   xmlNodePtr cur {root};
 
-  // clear pcr entries
-  pcrPorMap_.clear();
-
   // get table
   while(cur)
     {
       if((!xmlStrcmp(cur->name, toXMLChar("pcr"))))
         {
-          getTable(cur->xmlChildrenNode, pcrPorMap_);
+          getTable(cur->xmlChildrenNode, *pTable);
         }
 
       cur = cur->next;
@@ -163,34 +290,42 @@ EMANE::Models::TDMA::PCRManager::load(const std::string & uri)
   closeDoc(&pContext, &doc);
 
   // need at least 1 point
-  for(auto & iter : pcrPorMap_)
+  for(auto & iter : pTable->pcrPorMap_)
     {
-      if(iter.second.pcr_.size() < 1)
+      for(auto & curve : iter.second.curves_)
         {
-          std::stringstream excString;
-          excString << "TDMA::PCRManager::load: need at least 1 point to define a pcr curve " << std::ends;
-          throw EMANE::ConfigurationException(excString.str());
+          if(curve.pcr_.size() < 1)
+            {
+              std::stringstream excString;
+              excString << "TDMA::PCRManager::load: need at least 1 point to define a pcr curve " << std::ends;
+              throw EMANE::ConfigurationException(excString.str());
+            }
         }
     }
 
   // fill in points
-  interpolate();
+  interpolate(*pTable);
+
+  // adjust for packet length once instead of per packet
+  buildSizeTables(*pTable);
+
+  return pTable;
 }
 
 
 
 void
-EMANE::Models::TDMA::PCRManager::getTable(xmlNodePtr cur, PCRPORMap & map)
+EMANE::Models::TDMA::PCRManager::getTable(xmlNodePtr cur, PCRTable & table)
 {
   while(cur)
     {
       if((!xmlStrcmp(cur->name, toXMLChar("table"))))
         {
-          // save table packet size
-          tablePacketSize_ = Utils::ParameterConvert(getAttribute(cur, toXMLChar("pktsize"))).toUINT32();
+          // table packet size
+          const std::uint32_t u32PacketSize{Utils::ParameterConvert(getAttribute(cur, toXMLChar("pktsize"))).toUINT32()};
 
           // get each data rate
-          getDataRate(cur->xmlChildrenNode, map);
+          getDataRate(cur->xmlChildrenNode, u32PacketSize, table);
         }
 
       cur = cur->next;
@@ -199,7 +334,7 @@ EMANE::Models::TDMA::PCRManager::getTable(xmlNodePtr cur, PCRPORMap & map)
 
 
 void
-EMANE::Models::TDMA::PCRManager::getDataRate(xmlNodePtr cur, PCRPORMap & map)
+EMANE::Models::TDMA::PCRManager::getDataRate(xmlNodePtr cur, std::uint32_t u32PacketSize, PCRTable & table)
 {
   while(cur)
     {
@@ -211,15 +346,30 @@ EMANE::Models::TDMA::PCRManager::getDataRate(xmlNodePtr cur, PCRPORMap & map)
           // entry 
           PCRPOR entry;
 
+          entry.packetSize_ = u32PacketSize;
+
           // get pcr each row 
           getRows(cur->xmlChildrenNode, entry.pcr_);
 
-          if(map.insert(std::make_pair(u16DataRateIndex, entry)).second == false)
+          // or generate the curve from its modulation and code rate
+          if(xmlHasProp(cur, toXMLChar("modulation")))
             {
-              std::stringstream excString;
-              excString << "TDMA::PCRManager::getDataRate: duplicate datarate index value " << u16DataRateIndex << std::ends;
-              throw EMANE::ConfigurationException(excString.str());
+              if(!entry.pcr_.empty())
+                {
+                  std::stringstream excString;
+                  excString << "TDMA::PCRManager::getDataRate: datarate index value " << u16DataRateIndex
+                            << " has both rows and a modulation" << std::ends;
+                  throw EMANE::ConfigurationException(excString.str());
+                }
+
+              generatePCRCurve(getAttribute(cur, toXMLChar("modulation")),
+                               getAttribute(cur, toXMLChar("coderate")),
+                               entry,
+                               table);
             }
+
+          // one curve per datarate index and packet size
+          addPCRCurve(table, u16DataRateIndex, entry);
         }
 
       cur = cur->next;
@@ -268,145 +418,81 @@ EMANE::Models::TDMA::PCRManager::getRows(xmlNodePtr cur, PCREntryVector & vec)
 
 
 void
-EMANE::Models::TDMA::PCRManager::interpolate()
+EMANE::Models::TDMA::PCRManager::interpolate(PCRTable & table)
 {
-  // for each datarate
-  for(auto & iter : pcrPorMap_)
+  // for each datarate and packet size
+  for(auto & iter : table.pcrPorMap_)
     {
-      // for each sinr/pcr entry
-      for(size_t i = 0; i < (iter.second.pcr_.size() - 1); ++i)
+      for(auto & curve : iter.second.curves_)
         {
-          // x1
-          const int x1{static_cast<int>(iter.second.pcr_[i].fSINR_ * PRECISION_FACTOR)};
+          // model curves come generated
+          if(curve.por_)
+            {
+              continue;
+            }
 
-          // y1
-          const float y1{iter.second.pcr_[i].fPOR_};
+          PORVector por;
 
-          // x2
-          const int x2{static_cast<int>(iter.second.pcr_[i + 1].fSINR_ * PRECISION_FACTOR)};
+          // for each sinr/pcr entry
+          for(size_t i = 0; i < (curve.pcr_.size() - 1); ++i)
+            {
+              // x1
+              const int x1{static_cast<int>(curve.pcr_[i].fSINR_ * PCR_PRECISION_FACTOR)};
 
-          // y2
-          const float y2{iter.second.pcr_[i + 1].fPOR_};
+              // y1
+              const float y1{curve.pcr_[i].fPOR_};
 
-          // slope(m)
-          const float slope{(y2 - y1) / (x2 - x1)};
+              // x2
+              const int x2{static_cast<int>(curve.pcr_[i + 1].fSINR_ * PCR_PRECISION_FACTOR)};
 
-          // fill in between points
-          for(int dx = x1; dx < x2; ++dx)
-            {
-              // y = mx + b
-              const float por{(dx - x1) * slope + y1};
+              // y2
+              const float y2{curve.pcr_[i + 1].fPOR_};
 
-              // save value to end of vector
-              iter.second.por_.push_back(por);
+              // slope(m)
+              const float slope{(y2 - y1) / (x2 - x1)};
+
+              // fill in between points
+              for(int dx = x1; dx < x2; ++dx)
+                {
+                  // y = mx + b
+                  const float value{(dx - x1) * slope + y1};
+
+                  // save value to end of vector
+                  por.push_back(value);
+                }
             }
-        }
 
-      iter.second.por_.push_back(iter.second.pcr_[iter.second.pcr_.size() - 1].fPOR_);
+          por.push_back(curve.pcr_[curve.pcr_.size() - 1].fPOR_);
+
+          // moving the vector keeps its buffer where por_ points
+          curve.por_ = por.data();
+          curve.porCount_ = por.size();
+
+          table.storage_.push_back(std::move(por));
+        }
     }
 }
 
 
 
 
+std::shared_ptr<const EMANE::Models::TDMA::PCRTable>
+EMANE::Models::TDMA::PCRManager::getTable() const
+{
+  return pTable_;
+}
+
+
+
 float
 EMANE::Models::TDMA::PCRManager::getPCR(float fSINR, size_t packetLen, std::uint16_t u16DataRateIndex)
 {
-  const auto iter = pcrPorMap_.find(u16DataRateIndex);
+  swapPendingTable();
 
-  if(iter != pcrPorMap_.end())
-    {
-      // check low end
-      if(fSINR < iter->second.pcr_.front().fSINR_)
-        {
-          LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                 DEBUG_LEVEL,
-                                 "MACI %03hu PCRManager::%s: sinr %3.2f, for datarate index %hu, "
-                                 "is below the low limit sinr of %3.2f",
-                                 id_,
-                                 __func__,
-                                 fSINR, 
-                                 u16DataRateIndex,
-                                 iter->second.pcr_.front().fSINR_);
-
-          // full loss
-          return 0.0f;
-        }
-      // check high end
-      else if(fSINR > iter->second.pcr_.back().fSINR_)
-        {
-          LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                 DEBUG_LEVEL,
-                                 "MACI %03hu PCRManager::%s: sinr %3.2f, for datarate index %hu, "
-                                 "is above the high limit sinr of %3.2f",
-                                 id_, 
-                                 __func__, 
-                                 fSINR, 
-                                 u16DataRateIndex,
-                                 iter->second.pcr_.back().fSINR_);
-          // no loss
-          return 1.0f;
-        }
-      // lookup
-      else
-        {
-          float fPOR{};
+  // nothing loaded yet reads as an unsupported datarate
+  const PCRTable & table{pTable_ ? *pTable_ : EMPTY_PCR_TABLE};
 
-          // single point(front == back)
-          if(fSINR == iter->second.pcr_.front().fSINR_ && fSINR == iter->second.pcr_.back().fSINR_)
-            {
-              // get por
-              fPOR = iter->second.pcr_.front().fPOR_;
-            }
-          else
-            {
-              // sinr adjusted
-              const int sinrScaled{static_cast<int>(fSINR * PRECISION_FACTOR)};
-
-              // sinr offset from the front
-              const int sinrOffset{static_cast<int>(iter->second.pcr_.front().fSINR_ * PRECISION_FACTOR)};
-
-              // get the table index
-              int idx{sinrScaled - sinrOffset};
-
-              // cap max index, low end check covers min index
-              if(idx >= static_cast<int>(iter->second.por_.size()))
-               {
-                  idx = iter->second.por_.size() - 1;
-               }
-
-              // direct por lookup
-              fPOR = iter->second.por_[idx];
-
-              LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                     DEBUG_LEVEL, 
-                                     "MACI %03hu PCRManager::%s: lookup por %3.2f at table index %d",
-                                     id_,
-                                     __func__,
-                                     fPOR, 
-                                     idx);
-            }
-
-          // adjust por for packet length
-          if(tablePacketSize_ > 0)
-           {
-             fPOR = powf(fPOR, static_cast<float>(packetLen) / tablePacketSize_);
-           }
-
-          LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
-                                 DEBUG_LEVEL,
-                                 "MACI %03hu PCRManager::%s: sinr %3.2f, for datarate index %hu, por %3.2f",
-                                 id_, 
-                                 __func__, 
-                                 fSINR, 
-                                 u16DataRateIndex,
-                                 fPOR);
-
-          // return por
-          return fPOR;
-        }
-    }
-  else
+  if(!table.hasDataRate(u16DataRateIndex))
     {
       LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
                              DEBUG_LEVEL,
@@ -419,6 +505,38 @@ EMANE::Models::TDMA::PCRManager::getPCR(float fSINR, size_t packetLen, std::uint
       // full loss
       return 0.0;
     }
+
+  // single table read, length adjusted and bounded to the curve span
+  const float fPOR{table.getPOR(fSINR, packetLen, u16DataRateIndex)};
+
+  LOGGER_VERBOSE_LOGGING(pPlatformService_->logService(),
+                         DEBUG_LEVEL,
+                         "MACI %03hu PCRManager::%s: sinr %3.2f, len %zu, for datarate index %hu, por %3.2f",
+                         id_, 
+                         __func__, 
+                         fSINR, 
+                         packetLen,
+                         u16DataRateIndex,
+                         fPOR);
+
+  // return por
+  return fPOR;
+}
+
+
+
+void
+EMANE::Models::TDMA::PCRManager::getPCR(const float * pSINR,
+                                        const size_t * pPacketLen,
+                                        const std::uint16_t * pDataRateIndex,
+                                        float * pPCR,
+                                        size_t count)
+{
+  swapPendingTable();
+
+  const PCRTable & table{pTable_ ? *pTable_ : EMPTY_PCR_TABLE};
+
+  table.getPOR(pSINR, pPacketLen, pDataRateIndex, pPCR, count);
 }
 
 
@@ -40,11 +40,15 @@
 #include "emane/configurationexception.h"
 #include "emane/platformserviceprovider.h"
 
+#include "pcrtable.h"
+
 #include <libxml/parser.h>
 
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <vector>
-#include <map>
 
 namespace EMANE
  {
@@ -61,76 +65,6 @@ namespace EMANE
        */
         class PCRManager
         {
-        /**
-         *
-         * @struct PCREntry
-         *
-         * @brief proides a direct lookup mapping of packet completion to probability of reception
-         *
-         */
-          struct PCREntry
-          {
-            float fSINR_;
-            float fPOR_;
-
-          /**
-           *
-           * default constructor
-           *
-           */
-            PCREntry(): 
-             fSINR_{}, 
-             fPOR_{}
-             { } 
-
-          /**
-           *
-           * initialized constructor
-           *
-           * @param fSinr the singnal to noise ratio
-           * @param por  the probability of reception
-           *
-           */
-            PCREntry(float fSinr, float por):
-              fSINR_{fSinr}, 
-              fPOR_{por}
-            { }
-          }; 
-
-          /**
-           *
-           * @brief vector of PCREntry
-           *
-           */
-          typedef std::vector <PCREntry> PCREntryVector;
-
-          /**
-           *
-           * @brief vector of POR (probability of reception) values
-           *
-           */
-          typedef std::vector <float> PORVector;
-
-         /**
-          *
-          * @struct PCRPOR
-          *
-          * @brief proides a direct lookup mapping of packet completion to probability of reception over a range of entries
-          *
-          */
-          struct PCRPOR
-          {
-            PCREntryVector pcr_;
-            PORVector      por_;
-          };
-
-          /**
-           *
-           * @brief map of data rate index to PCRPOR
-           *
-           */
-          typedef std::map <std::uint16_t, PCRPOR> PCRPORMap;
-
         public:
           /**
            * initialized constructor
@@ -151,7 +85,8 @@ namespace EMANE
 
           /**
            *  
-           * loads the pcr curve
+           * loads the pcr curve, a file already loaded by another NEM
+           * of this process is shared rather than parsed again
            *
            * @param uri the location of the pcr curve file
            *
@@ -159,6 +94,18 @@ namespace EMANE
            */
           void load(const std::string & uri);
 
+          /**
+           *
+           * loads the pcr curve on a separate thread, the new table replaces
+           * the current one at the next getPCR and a load error keeps the
+           * current one. Never waits, a uri given while a load runs is
+           * loaded after it, only the latest one if several were given
+           *
+           * @param uri the location of the pcr curve file
+           *
+           */
+          void reload(const std::string & uri);
+
           /**
            *  
            * provides the pcr for a given sinr, packet size and data rate index
@@ -172,7 +119,39 @@ namespace EMANE
            */
           float getPCR(float fSinr, size_t size, std::uint16_t DataRateIndex);
 
+          /**
+           *
+           * provides the pcr of count packets at once, without logging
+           *
+           * @param pSINR the signal to noise ratio of each packet
+           * @param pPacketLen the size in bytes of each packet
+           * @param pDataRateIndex the data rate index of each packet
+           * @param pPCR receives the pcr of each packet
+           * @param count the number of packets
+           *
+           */
+          void getPCR(const float * pSINR,
+                      const size_t * pPacketLen,
+                      const std::uint16_t * pDataRateIndex,
+                      float * pPCR,
+                      size_t count);
+
+          /**
+           *
+           * @return the loaded table, NULL before load
+           *
+           */
+          std::shared_ptr<const PCRTable> getTable() const;
+
         private:
+          std::shared_ptr<const PCRTable> build(const std::string & uri);
+
+          std::shared_ptr<PCRTable> parse(const std::string & uri);
+
+          void swapPendingTable();
+
+          void loadRequested();
+
           void openDoc(const std::string & uri, xmlParserCtxtPtr * ppContext,
                      xmlDoc ** ppDocument, xmlNode ** ppRoot);
 
@@ -182,21 +161,31 @@ namespace EMANE
 
           std::string getContent(xmlNodePtr cur);
 
-          void getTable(xmlNodePtr cur, PCRManager::PCRPORMap & map);
+          void getTable(xmlNodePtr cur, PCRTable & table);
 
-          void getDataRate(xmlNodePtr cur, PCRManager::PCRPORMap & map);
+          void getDataRate(xmlNodePtr cur, std::uint32_t u32PacketSize, PCRTable & table);
 
-          void getRows(xmlNodePtr cur, PCRManager::PCREntryVector & vec);
+          void getRows(xmlNodePtr cur, PCREntryVector & vec);
 
-          void interpolate();
+          void interpolate(PCRTable & table);
 
           const NEMId id_;
 
           PlatformServiceProvider * pPlatformService_;
 
-          PCRPORMap pcrPorMap_;
+          std::shared_ptr<const PCRTable> pTable_;
+
+          // reloaded table waiting for the thread calling getPCR
+          std::mutex pendingLock_;
+          std::shared_ptr<const PCRTable> pPendingTable_;
+          std::atomic<bool> bHasPendingTable_;
+
+          // latest reload request, taken by the load thread, guarded by pendingLock_
+          std::string requestedUri_;
+          bool bHasRequest_;
+          bool bLoading_;
 
-          size_t tablePacketSize_;
+          std::future<void> pendingLoad_;
         };
       }
    }
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) Her Majesty the Queen in right of Canada  (2014)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of Her Majesty the Queen in right of Canada nor
+ *   the names of her contributors may be used to endorse or promote
+ *   products derived from this software without specific prior written
+ *   permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * See toplevel COPYING for more information.
+ */
+
+#include "pcrmodel.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+  // span searched for the curve, trimmed to where the por changes
+  const int MODEL_SINR_LOW{-20 * EMANE::Models::TDMA::PCR_PRECISION_FACTOR};
+  const int MODEL_SINR_HIGH{40 * EMANE::Models::TDMA::PCR_PRECISION_FACTOR};
+
+  // por within this of 0 or 1 is left to the full loss and no loss ends
+  const double MODEL_POR_EPSILON{1e-5};
+
+  struct Modulation
+  {
+    const char * pzName_;
+    int bitsPerSymbol_;
+  };
+
+  const Modulation MODULATIONS[]
+    {
+      {"bpsk", 1},
+      {"qpsk", 2},
+      {"16qam", 4},
+      {"64qam", 6},
+      {"256qam", 8},
+    };
+
+  struct CodeRate
+  {
+    const char * pzName_;
+    double dRate_;
+    int freeDistance_;
+  };
+
+  // free distance of the K=7 (133,171) code and its punctured rates
+  const CodeRate CODE_RATES[]
+    {
+      {"1/2", 1.0 / 2, 10},
+      {"2/3", 2.0 / 3, 6},
+      {"3/4", 3.0 / 4, 5},
+      {"5/6", 5.0 / 6, 4},
+      {"1", 1.0, 1},
+    };
+
+  EMANE::ConfigurationException modelException(const char * pzWhat, const std::string & sValue)
+  {
+    std::stringstream excString;
+    excString << "TDMA::PCRModel::generatePCRCurve: unknown " << pzWhat << " " << sValue << std::ends;
+    return EMANE::ConfigurationException(excString.str());
+  }
+
+  double q(double x)
+  {
+    return 0.5 * erfc(x / sqrt(2.0));
+  }
+
+  // bit error rate at symbol sinr (linear), coding gain already applied
+  double bitErrorRate(int bitsPerSymbol, double dSINR)
+  {
+    if(bitsPerSymbol <= 2)
+      {
+        // bpsk, and qpsk as two bpsk rails
+        return q(sqrt(2.0 * dSINR / bitsPerSymbol));
+      }
+
+    // square qam, nearest neighbour gray coded approximation
+    const double dM{static_cast<double>(1 << bitsPerSymbol)};
+
+    return 4.0 / bitsPerSymbol * (1.0 - 1.0 / sqrt(dM)) * q(sqrt(3.0 * dSINR / (dM - 1.0)));
+  }
+}
+
+void
+EMANE::Models::TDMA::generatePCRCurve(const std::string & sModulation,
+                                      const std::string & sCodeRate,
+                                      PCRPOR & curve,
+                                      PCRTable & table)
+{
+  const Modulation * pModulation{};
+
+  for(const auto & modulation : MODULATIONS)
+    {
+      if(sModulation == modulation.pzName_)
+        {
+          pModulation = &modulation;
+        }
+    }
+
+  if(!pModulation)
+    {
+      throw modelException("modulation", sModulation);
+    }
+
+  const CodeRate * pCodeRate{};
+
+  for(const auto & codeRate : CODE_RATES)
+    {
+      if(sCodeRate == codeRate.pzName_)
+        {
+          pCodeRate = &codeRate;
+        }
+    }
+
+  if(!pCodeRate)
+    {
+      throw modelException("code rate", sCodeRate);
+    }
+
+  // soft decision gain of rate * free distance over the coded symbol sinr
+  const double dCodingGain{pCodeRate->dRate_ * pCodeRate->freeDistance_};
+
+  if(curve.packetSize_ == 0)
+    {
+      throw modelException("packet size", "0");
+    }
+
+  const double dBits{8.0 * curve.packetSize_};
+
+  PORVector por(MODEL_SINR_HIGH - MODEL_SINR_LOW + 1);
+
+  for(size_t i = 0; i < por.size(); ++i)
+    {
+      const double dSINR{pow(10.0, (MODEL_SINR_LOW + static_cast<int>(i)) / (10.0 * PCR_PRECISION_FACTOR))};
+
+      const double dBER{std::min(0.5, bitErrorRate(pModulation->bitsPerSymbol_, dSINR * dCodingGain))};
+
+      por[i] = exp(dBits * log1p(-dBER));
+    }
+
+  size_t first{};
+
+  while(first + 1 < por.size() && por[first] < MODEL_POR_EPSILON)
+    {
+      ++first;
+    }
+
+  size_t last{por.size() - 1};
+
+  while(last > first && por[last - 1] > 1.0 - MODEL_POR_EPSILON)
+    {
+      --last;
+    }
+
+  // end points as read by the lookup, see PCRRate::getPOR
+  const float fFront{(MODEL_SINR_LOW + static_cast<int>(first)) / static_cast<float>(PCR_PRECISION_FACTOR)};
+  const float fBack{(MODEL_SINR_LOW + static_cast<int>(last)) / static_cast<float>(PCR_PRECISION_FACTOR)};
+
+  const int sinrFront{static_cast<int>(fFront * PCR_PRECISION_FACTOR)};
+  const int sinrBack{static_cast<int>(fBack * PCR_PRECISION_FACTOR)};
+
+  PORVector trimmed;
+
+  for(int sinr = sinrFront; sinr <= sinrBack; ++sinr)
+    {
+      trimmed.push_back(por[std::min(std::max(sinr - MODEL_SINR_LOW, 0), static_cast<int>(por.size()) - 1)]);
+    }
+
+  curve.pcr_ = PCREntryVector{PCREntry{fFront, trimmed.front()}, PCREntry{fBack, trimmed.back()}};
+
+  // moving the vector keeps its buffer where por_ points
+  curve.por_ = trimmed.data();
+  curve.porCount_ = trimmed.size();
+
+  table.storage_.push_back(std::move(trimmed));
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Her Majesty the Queen in right of Canada  (2014)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of Her Majesty the Queen in right of Canada nor
+ *   the names of her contributors may be used to endorse or promote
+ *   products derived from this software without specific prior written
+ *   permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * See toplevel COPYING for more information.
+ */
+
+#ifndef TDMAMAC_PCRMODEL_HEADER_
+#define TDMAMAC_PCRMODEL_HEADER_
+
+#include "pcrtable.h"
+
+#include <string>
+
+namespace EMANE
+{
+  namespace Models
+  {
+    namespace TDMA
+    {
+      /**
+       * @brief Generates the por of curve from a modulation and code
+       * rate instead of curve points. Bit errors follow the AWGN bit
+       * error rate of the modulation, with the soft decision coding gain
+       * of the K=7 convolutional code punctured to the code rate, and
+       * a packet of curve.packetSize_ bytes needs every bit right.
+       * The table is held in table.storage_.
+       *
+       * @param sModulation bpsk, qpsk, 16qam, 64qam or 256qam
+       * @param sCodeRate 1/2, 2/3, 3/4, 5/6 or 1 (uncoded)
+       *
+       * @throw ConfigurationException on an unknown modulation or code rate
+       */
+      void generatePCRCurve(const std::string & sModulation,
+                            const std::string & sCodeRate,
+                            PCRPOR & curve,
+                            PCRTable & table);
+    }
+  }
+}
+
+#endif // TDMAMAC_PCRMODEL_HEADER_
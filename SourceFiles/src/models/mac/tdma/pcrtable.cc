@@ -0,0 +1,734 @@
+/*
+ * Copyright (c) Her Majesty the Queen in right of Canada  (2014)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of Her Majesty the Queen in right of Canada nor
+ *   the names of her contributors may be used to endorse or promote
+ *   products derived from this software without specific prior written
+ *   permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * See toplevel COPYING for more information.
+ */
+
+#include "pcrtable.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <sstream>
+
+namespace
+{
+  const std::string FILE_SCHEME{"file://"};
+
+  /*
+   * Compiled format, native byte order:
+   *   header, one directory entry per data rate and packet size, one
+   *   per data rate, then per curve entry the curve points as (sinr, por)
+   *   float pairs and the interpolated por floats, and per data rate the
+   *   size adjusted por rows, each array starting on a DATA_ALIGNMENT
+   *   boundary. Everything the lookup reads is mapped, nothing rebuilt.
+   */
+  const char PCR_BINARY_MAGIC[8]{'T','D','M','A','P','C','R','B'};
+  const std::uint32_t PCR_BINARY_VERSION{3};
+  const std::uint32_t PCR_BINARY_BYTE_ORDER{0x01020304};
+  const size_t DATA_ALIGNMENT{64};
+
+  // sinr range the curve file parser accepts, see PCRManager::getRows
+  const float PCR_SINR_LIMIT{255.0f};
+
+  struct PCRBinaryHeader
+  {
+    char magic_[8];
+    std::uint32_t version_;
+    std::uint32_t byteOrder_;
+    std::uint32_t curveCount_;
+    std::uint32_t rateCount_;
+    std::uint64_t fileSize_;
+    std::uint32_t sizeBucketBytes_;
+    std::uint32_t sizeBucketCount_;
+  };
+
+  struct PCRBinaryCurve
+  {
+    std::uint16_t dataRateIndex_;
+    std::uint16_t reserved_;
+    std::uint32_t packetSize_;
+    std::uint64_t pointCount_;
+    std::uint64_t pointOffset_;
+    std::uint64_t porCount_;
+    std::uint64_t porOffset_;
+  };
+
+  struct PCRBinaryRate
+  {
+    std::uint16_t dataRateIndex_;
+    std::uint16_t reserved_;
+    std::int32_t sinrOffset_;
+    std::int32_t sinrCount_;
+    std::uint32_t reserved2_;
+    std::uint64_t porOffset_;	// PCR_SIZE_BUCKET_COUNT rows of sinrCount_
+  };
+
+  size_t align(size_t offset)
+  {
+    return (offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+  }
+
+  std::string getPath(const std::string & uri)
+  {
+    return uri.compare(0, FILE_SCHEME.size(), FILE_SCHEME) ?
+      uri : uri.substr(FILE_SCHEME.size());
+  }
+
+  EMANE::ConfigurationException pcrException(const char * pzFunc,
+                                              const std::string & uri,
+                                              const char * pzWhat)
+  {
+    std::stringstream excString;
+    excString << "TDMA::PCRTable::" << pzFunc << ": " << uri << " " << pzWhat << std::ends;
+    return EMANE::ConfigurationException(excString.str());
+  }
+
+  // curve points as the lookup relies on them: finite sinr strictly
+  // increasing within PCR_SINR_LIMIT, por a probability, and as many
+  // interpolated por values as the points span
+  bool isValidCurve(const EMANE::Models::TDMA::PCRPOR & curve)
+  {
+    float fLast{-std::numeric_limits<float>::infinity()};
+
+    for(const auto & point : curve.pcr_)
+      {
+        if(!(point.fSINR_ > fLast) ||
+           !(point.fSINR_ <= PCR_SINR_LIMIT) ||
+           !(point.fSINR_ >= -PCR_SINR_LIMIT) ||
+           !(point.fPOR_ >= 0.0f) ||
+           !(point.fPOR_ <= 1.0f))
+          {
+            return false;
+          }
+
+        fLast = point.fSINR_;
+      }
+
+    const int sinrFront{static_cast<int>(curve.pcr_.front().fSINR_ * EMANE::Models::TDMA::PCR_PRECISION_FACTOR)};
+
+    const int sinrBack{static_cast<int>(curve.pcr_.back().fSINR_ * EMANE::Models::TDMA::PCR_PRECISION_FACTOR)};
+
+    return curve.porCount_ == static_cast<size_t>(sinrBack - sinrFront + 1);
+  }
+
+  // rate lookups of table without their por, returns the floats the size
+  // adjusted tables of all rates need and where each starts
+  size_t setRateLookup(EMANE::Models::TDMA::PCRTable & table, std::vector<size_t> & offsets)
+  {
+    using namespace EMANE::Models::TDMA;
+
+    table.rateLookup_.assign(table.pcrPorMap_.empty() ? 0 : table.pcrPorMap_.rbegin()->first + 1,
+                             PCRRateLookup{});
+
+    size_t total{};
+
+    for(const auto & iter : table.pcrPorMap_)
+      {
+        const PCRRate & rate = iter.second;
+
+        PCRRateLookup & lookup = table.rateLookup_[iter.first];
+
+        lookup.fSINRLow_ = rate.curves_.front().pcr_.front().fSINR_;
+        lookup.fSINRHigh_ = rate.curves_.front().pcr_.back().fSINR_;
+
+        for(const auto & curve : rate.curves_)
+          {
+            lookup.fSINRLow_ = std::min(lookup.fSINRLow_, curve.pcr_.front().fSINR_);
+            lookup.fSINRHigh_ = std::max(lookup.fSINRHigh_, curve.pcr_.back().fSINR_);
+          }
+
+        lookup.sinrOffset_ = static_cast<int>(lookup.fSINRLow_ * PCR_PRECISION_FACTOR);
+
+        lookup.sinrCount_ = static_cast<int>(lookup.fSINRHigh_ * PCR_PRECISION_FACTOR) - lookup.sinrOffset_ + 1;
+
+        lookup.pRate_ = &rate;
+
+        // each rate starts on a cache line
+        total = align(total * sizeof(float)) / sizeof(float);
+
+        offsets.push_back(total);
+
+        total += PCR_SIZE_BUCKET_COUNT * lookup.sinrCount_;
+      }
+
+    return total;
+  }
+
+  // por of rate adjusted to each size bucket, one row per bucket
+  void fillSizeTable(const EMANE::Models::TDMA::PCRRate & rate,
+                     const EMANE::Models::TDMA::PCRRateLookup & lookup,
+                     float * pPor)
+  {
+    using namespace EMANE::Models::TDMA;
+
+    for(size_t bucket = 0; bucket < PCR_SIZE_BUCKET_COUNT; ++bucket)
+      {
+        // middle of the bucket stands for all lengths in it
+        const size_t packetLen{bucket * PCR_SIZE_BUCKET_BYTES + PCR_SIZE_BUCKET_BYTES / 2};
+
+        const PCRPOR & curve = rate.getCurve(packetLen);
+
+        const float fExponent{curve.packetSize_ > 0 ?
+            static_cast<float>(packetLen) / curve.packetSize_ : 1.0f};
+
+        float * pRow{pPor + bucket * lookup.sinrCount_};
+
+        for(int i = 0; i < lookup.sinrCount_; ++i)
+          {
+            pRow[i] = powf(PCRRate::getPOR(curve, lookup.sinrOffset_ + i), fExponent);
+          }
+      }
+  }
+
+  // a uri without a file to stat gets a zero time and is cached by uri only
+  timespec getModificationTime(const std::string & uri)
+  {
+    std::string path{getPath(uri)};
+
+    struct stat st;
+
+    if(stat(path.c_str(), &st))
+      {
+        return timespec{};
+      }
+
+    return st.st_mtim;
+  }
+}
+
+EMANE::Models::TDMA::PCRTableCache::PCRTableCache():
+  lock_{},
+  entries_{}
+{}
+
+EMANE::Models::TDMA::PCRTableCache &
+EMANE::Models::TDMA::PCRTableCache::instance()
+{
+  static PCRTableCache cache;
+
+  return cache;
+}
+
+std::shared_ptr<const EMANE::Models::TDMA::PCRTable>
+EMANE::Models::TDMA::PCRTableCache::get(const std::string & uri, const Builder & build)
+{
+  const timespec mtime{getModificationTime(uri)};
+
+  // held while building so concurrent NEM starts parse only once
+  std::lock_guard<std::mutex> m(lock_);
+
+  auto iter = entries_.find(uri);
+
+  if(iter != entries_.end() &&
+     iter->second.mtime_.tv_sec == mtime.tv_sec &&
+     iter->second.mtime_.tv_nsec == mtime.tv_nsec)
+    {
+      if(auto pTable = iter->second.pTable_.lock())
+        {
+          return pTable;
+        }
+    }
+
+  std::shared_ptr<const PCRTable> pTable{build(uri)};
+
+  entries_[uri] = Entry{mtime, pTable};
+
+  return pTable;
+}
+
+const EMANE::Models::TDMA::PCRPOR &
+EMANE::Models::TDMA::PCRRate::getCurve(size_t packetLen) const
+{
+  auto iter = curves_.begin();
+
+  // curves are in increasing packet size, stop at the first not smaller
+  while(iter + 1 != curves_.end() && iter->packetSize_ < packetLen)
+    {
+      ++iter;
+    }
+
+  if(iter != curves_.begin() &&
+     iter->packetSize_ >= packetLen &&
+     packetLen - (iter - 1)->packetSize_ < iter->packetSize_ - packetLen)
+    {
+      --iter;
+    }
+
+  return *iter;
+}
+
+float
+EMANE::Models::TDMA::PCRRate::getPOR(const PCRPOR & curve, int sinrScaled)
+{
+  const int sinrFront{static_cast<int>(curve.pcr_.front().fSINR_ * PCR_PRECISION_FACTOR)};
+
+  const int sinrBack{static_cast<int>(curve.pcr_.back().fSINR_ * PCR_PRECISION_FACTOR)};
+
+  if(sinrScaled < sinrFront)
+    {
+      return 0.0f;
+    }
+  else if(sinrScaled > sinrBack)
+    {
+      return 1.0f;
+    }
+
+  // cap max index, the low end check covers min index
+  const size_t idx{std::min<size_t>(sinrScaled - sinrFront, curve.porCount_ - 1)};
+
+  return curve.por_[idx];
+}
+
+void
+EMANE::Models::TDMA::addPCRCurve(PCRTable & table, std::uint16_t u16DataRateIndex, const PCRPOR & curve)
+{
+  // the MAC header carries the data rate index in a byte, 0 is unused
+  if(u16DataRateIndex < 1 || u16DataRateIndex > std::numeric_limits<std::uint8_t>::max())
+    {
+      std::stringstream excString;
+      excString << "TDMA::PCRTable::addPCRCurve: datarate index value "
+                << u16DataRateIndex << " out of range [1,255]" << std::ends;
+      throw EMANE::ConfigurationException(excString.str());
+    }
+
+  PCRPORVector & curves = table.pcrPorMap_[u16DataRateIndex].curves_;
+
+  auto iter = curves.begin();
+
+  while(iter != curves.end() && iter->packetSize_ < curve.packetSize_)
+    {
+      ++iter;
+    }
+
+  if(iter != curves.end() && iter->packetSize_ == curve.packetSize_)
+    {
+      std::stringstream excString;
+      excString << "TDMA::PCRTable::addPCRCurve: duplicate datarate index value "
+                << u16DataRateIndex << " for pktsize " << curve.packetSize_ << std::ends;
+      throw EMANE::ConfigurationException(excString.str());
+    }
+
+  curves.insert(iter, curve);
+}
+
+void
+EMANE::Models::TDMA::buildSizeTables(PCRTable & table)
+{
+  std::vector<size_t> offsets;
+
+  const size_t total{setRateLookup(table, offsets)};
+
+  if(!total)
+    {
+      return;
+    }
+
+  void * p{};
+
+  if(posix_memalign(&p, DATA_ALIGNMENT, total * sizeof(float)))
+    {
+      throw std::bad_alloc{};
+    }
+
+  table.pSizePor_.reset(static_cast<float *>(p), free);
+
+  auto offset = offsets.begin();
+
+  for(const auto & iter : table.pcrPorMap_)
+    {
+      PCRRateLookup & lookup = table.rateLookup_[iter.first];
+
+      float * pPor{table.pSizePor_.get() + *offset++};
+
+      fillSizeTable(iter.second, lookup, pPor);
+
+      lookup.pPor_ = pPor;
+    }
+}
+
+float
+EMANE::Models::TDMA::PCRTable::getPOR(float fSINR, size_t packetLen, std::uint16_t u16DataRateIndex) const
+{
+  if(!hasDataRate(u16DataRateIndex))
+    {
+      return 0.0f;
+    }
+
+  const PCRRateLookup & lookup = rateLookup_[u16DataRateIndex];
+
+  // clamp rather than branch, out of span sinr is selected below,
+  // max before min so a NaN sinr clamps too
+  const float fClamped{std::min(lookup.fSINRHigh_, std::max(lookup.fSINRLow_, fSINR))};
+
+  const int sinrScaled{static_cast<int>(fClamped * PCR_PRECISION_FACTOR)};
+
+  const size_t bucket{packetLen / PCR_SIZE_BUCKET_BYTES};
+
+  float fPOR{};
+
+  if(bucket < PCR_SIZE_BUCKET_COUNT)
+    {
+      fPOR = lookup.pPor_[bucket * lookup.sinrCount_ + (sinrScaled - lookup.sinrOffset_)];
+    }
+  else
+    {
+      // longer than the precomputed buckets, adjust this one
+      const PCRPOR & curve = lookup.pRate_->getCurve(packetLen);
+
+      fPOR = PCRRate::getPOR(curve, sinrScaled);
+
+      if(curve.packetSize_ > 0)
+        {
+          fPOR = powf(fPOR, static_cast<float>(packetLen) / curve.packetSize_);
+        }
+    }
+
+  fPOR = fSINR < lookup.fSINRLow_ ? 0.0f : fPOR;
+
+  return fSINR > lookup.fSINRHigh_ ? 1.0f : fPOR;
+}
+
+void
+EMANE::Models::TDMA::PCRTable::getPOR(const float * pSINR,
+                                      const size_t * pPacketLen,
+                                      const std::uint16_t * pDataRateIndex,
+                                      float * pPOR,
+                                      size_t count) const
+{
+  for(size_t i = 0; i < count; ++i)
+    {
+      pPOR[i] = getPOR(pSINR[i], pPacketLen[i], pDataRateIndex[i]);
+    }
+}
+
+bool
+EMANE::Models::TDMA::isPCRBinary(const std::string & uri)
+{
+  std::ifstream stream{getPath(uri).c_str(), std::ios::binary};
+
+  char magic[sizeof(PCR_BINARY_MAGIC)]{};
+
+  return stream.read(magic, sizeof(magic)) &&
+    !memcmp(magic, PCR_BINARY_MAGIC, sizeof(magic));
+}
+
+std::shared_ptr<EMANE::Models::TDMA::PCRTable>
+EMANE::Models::TDMA::loadPCRBinary(const std::string & uri)
+{
+  int fd{open(getPath(uri).c_str(), O_RDONLY)};
+
+  if(fd < 0)
+    {
+      throw pcrException(__func__, uri, "could not be opened");
+    }
+
+  struct stat st;
+
+  if(fstat(fd, &st) || st.st_size < static_cast<off_t>(sizeof(PCRBinaryHeader)))
+    {
+      close(fd);
+      throw pcrException(__func__, uri, "is too short");
+    }
+
+  size_t size{static_cast<size_t>(st.st_size)};
+
+  void * pAddr{mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0)};
+
+  // the mapping stays valid without the descriptor
+  close(fd);
+
+  if(pAddr == MAP_FAILED)
+    {
+      throw pcrException(__func__, uri, "could not be mapped");
+    }
+
+  std::shared_ptr<PCRTable> pTable{new PCRTable{}};
+
+  pTable->pMapping_.reset(pAddr, [size](const void * p)
+                          {
+                            munmap(const_cast<void *>(p), size);
+                          });
+
+  const char * pBase{static_cast<const char *>(pAddr)};
+
+  const PCRBinaryHeader * pHeader{reinterpret_cast<const PCRBinaryHeader *>(pBase)};
+
+  if(memcmp(pHeader->magic_, PCR_BINARY_MAGIC, sizeof(PCR_BINARY_MAGIC)) ||
+     pHeader->version_ != PCR_BINARY_VERSION)
+    {
+      throw pcrException(__func__, uri, "is not a supported compiled pcr table");
+    }
+
+  if(pHeader->byteOrder_ != PCR_BINARY_BYTE_ORDER)
+    {
+      throw pcrException(__func__, uri, "was compiled for another byte order");
+    }
+
+  if(pHeader->sizeBucketBytes_ != PCR_SIZE_BUCKET_BYTES ||
+     pHeader->sizeBucketCount_ != PCR_SIZE_BUCKET_COUNT)
+    {
+      throw pcrException(__func__, uri, "was compiled for other packet size buckets");
+    }
+
+  if(pHeader->fileSize_ != size ||
+     pHeader->curveCount_ > (size - sizeof(PCRBinaryHeader)) / sizeof(PCRBinaryCurve) ||
+     pHeader->rateCount_ > (size - sizeof(PCRBinaryHeader) - pHeader->curveCount_ * sizeof(PCRBinaryCurve)) / sizeof(PCRBinaryRate))
+    {
+      throw pcrException(__func__, uri, "is truncated");
+    }
+
+  const PCRBinaryCurve * pCurves{reinterpret_cast<const PCRBinaryCurve *>(pBase + sizeof(PCRBinaryHeader))};
+
+  for(std::uint32_t i = 0; i < pHeader->curveCount_; ++i)
+    {
+      const PCRBinaryCurve & curve{pCurves[i]};
+
+      if(curve.pointCount_ < 1 ||
+         curve.porCount_ < 1 ||
+         curve.pointOffset_ % sizeof(float) ||
+         curve.porOffset_ % sizeof(float) ||
+         curve.pointOffset_ > size ||
+         curve.porOffset_ > size ||
+         curve.pointCount_ > (size - curve.pointOffset_) / (2 * sizeof(float)) ||
+         curve.porCount_ > (size - curve.porOffset_) / sizeof(float))
+        {
+          throw pcrException(__func__, uri, "has a bad data rate entry");
+        }
+
+      PCRPOR entry;
+
+      entry.packetSize_ = curve.packetSize_;
+
+      const float * pPoints{reinterpret_cast<const float *>(pBase + curve.pointOffset_)};
+
+      // the points are few and only bound checks read them, copy them
+      for(std::uint64_t j = 0; j < curve.pointCount_; ++j)
+        {
+          entry.pcr_.push_back(PCREntry(pPoints[2 * j], pPoints[2 * j + 1]));
+        }
+
+      entry.por_ = reinterpret_cast<const float *>(pBase + curve.porOffset_);
+      entry.porCount_ = curve.porCount_;
+
+      if(!isValidCurve(entry))
+        {
+          throw pcrException(__func__, uri, "has a bad curve");
+        }
+
+      addPCRCurve(*pTable, curve.dataRateIndex_, entry);
+    }
+
+  // what the size tables must look like for these curves
+  std::vector<size_t> offsets;
+
+  setRateLookup(*pTable, offsets);
+
+  const PCRBinaryRate * pRates{reinterpret_cast<const PCRBinaryRate *>(pCurves + pHeader->curveCount_)};
+
+  for(std::uint32_t i = 0; i < pHeader->rateCount_; ++i)
+    {
+      const PCRBinaryRate & rate{pRates[i]};
+
+      if(rate.dataRateIndex_ >= pTable->rateLookup_.size() ||
+         !pTable->rateLookup_[rate.dataRateIndex_].pRate_ ||
+         pTable->rateLookup_[rate.dataRateIndex_].pPor_)
+        {
+          throw pcrException(__func__, uri, "has a bad data rate entry");
+        }
+
+      PCRRateLookup & lookup = pTable->rateLookup_[rate.dataRateIndex_];
+
+      if(rate.sinrOffset_ != lookup.sinrOffset_ ||
+         rate.sinrCount_ != lookup.sinrCount_ ||
+         rate.porOffset_ % DATA_ALIGNMENT ||
+         rate.porOffset_ > size ||
+         PCR_SIZE_BUCKET_COUNT * lookup.sinrCount_ > (size - rate.porOffset_) / sizeof(float))
+        {
+          throw pcrException(__func__, uri, "has a bad size table");
+        }
+
+      lookup.pPor_ = reinterpret_cast<const float *>(pBase + rate.porOffset_);
+    }
+
+  for(const auto & iter : pTable->pcrPorMap_)
+    {
+      if(!pTable->rateLookup_[iter.first].pPor_)
+        {
+          throw pcrException(__func__, uri, "is missing a size table");
+        }
+    }
+
+  return pTable;
+}
+
+void
+EMANE::Models::TDMA::savePCRBinary(const PCRTable & table, const std::string & path)
+{
+  PCRBinaryHeader header{};
+
+  memcpy(header.magic_, PCR_BINARY_MAGIC, sizeof(PCR_BINARY_MAGIC));
+  header.version_ = PCR_BINARY_VERSION;
+  header.byteOrder_ = PCR_BINARY_BYTE_ORDER;
+
+  std::vector<PCRBinaryCurve> curves;
+  std::vector<const PCRPOR *> entries;
+  std::vector<PCRBinaryRate> rates;
+
+  for(const auto & iter : table.pcrPorMap_)
+    {
+      if(!table.hasDataRate(iter.first))
+        {
+          throw pcrException(__func__, path, "has no size tables built");
+        }
+
+      PCRBinaryRate rate{};
+
+      rate.dataRateIndex_ = iter.first;
+      rate.sinrOffset_ = table.rateLookup_[iter.first].sinrOffset_;
+      rate.sinrCount_ = table.rateLookup_[iter.first].sinrCount_;
+
+      rates.push_back(rate);
+
+      for(const auto & entry : iter.second.curves_)
+        {
+          PCRBinaryCurve curve{};
+
+          curve.dataRateIndex_ = iter.first;
+          curve.packetSize_ = entry.packetSize_;
+          curve.pointCount_ = entry.pcr_.size();
+          curve.porCount_ = entry.porCount_;
+
+          curves.push_back(curve);
+          entries.push_back(&entry);
+        }
+    }
+
+  header.curveCount_ = curves.size();
+  header.rateCount_ = rates.size();
+  header.sizeBucketBytes_ = PCR_SIZE_BUCKET_BYTES;
+  header.sizeBucketCount_ = PCR_SIZE_BUCKET_COUNT;
+
+  size_t offset{sizeof(PCRBinaryHeader) +
+      curves.size() * sizeof(PCRBinaryCurve) +
+      rates.size() * sizeof(PCRBinaryRate)};
+
+  for(auto & curve : curves)
+    {
+      curve.pointOffset_ = offset = align(offset);
+      offset += curve.pointCount_ * 2 * sizeof(float);
+      curve.porOffset_ = offset = align(offset);
+      offset += curve.porCount_ * sizeof(float);
+    }
+
+  for(auto & rate : rates)
+    {
+      rate.porOffset_ = offset = align(offset);
+      offset += PCR_SIZE_BUCKET_COUNT * rate.sinrCount_ * sizeof(float);
+    }
+
+  header.fileSize_ = offset;
+
+  std::vector<char> image(offset, 0);
+
+  memcpy(image.data(), &header, sizeof(header));
+
+  memcpy(image.data() + sizeof(header), curves.data(), curves.size() * sizeof(PCRBinaryCurve));
+
+  memcpy(image.data() + sizeof(header) + curves.size() * sizeof(PCRBinaryCurve),
+         rates.data(), rates.size() * sizeof(PCRBinaryRate));
+
+  for(const auto & rate : rates)
+    {
+      memcpy(image.data() + rate.porOffset_,
+             table.rateLookup_[rate.dataRateIndex_].pPor_,
+             PCR_SIZE_BUCKET_COUNT * rate.sinrCount_ * sizeof(float));
+    }
+
+  for(size_t i = 0; i < curves.size(); ++i)
+    {
+      float * pPoints{reinterpret_cast<float *>(image.data() + curves[i].pointOffset_)};
+
+      for(const auto & point : entries[i]->pcr_)
+        {
+          *pPoints++ = point.fSINR_;
+          *pPoints++ = point.fPOR_;
+        }
+
+      memcpy(image.data() + curves[i].porOffset_, entries[i]->por_, curves[i].porCount_ * sizeof(float));
+    }
+
+  // running NEMs may map the file at path, replace it instead of
+  // rewriting it so their mapping keeps the old contents
+  std::string tmpPath{path + ".XXXXXX"};
+
+  int fd{mkstemp(&tmpPath[0])};
+
+  if(fd < 0)
+    {
+      throw pcrException(__func__, path, "could not be created");
+    }
+
+  const mode_t mask{umask(0)};
+
+  umask(mask);
+
+  bool bWritten{!fchmod(fd, 0666 & ~mask)};
+
+  for(size_t done = 0; bWritten && done < image.size();)
+    {
+      const ssize_t count{write(fd, image.data() + done, image.size() - done)};
+
+      bWritten = count > 0;
+
+      done += bWritten ? count : 0;
+    }
+
+  bWritten = !close(fd) && bWritten;
+
+  if(!bWritten || rename(tmpPath.c_str(), path.c_str()))
+    {
+      unlink(tmpPath.c_str());
+
+      throw pcrException(__func__, path, "could not be written");
+    }
+}
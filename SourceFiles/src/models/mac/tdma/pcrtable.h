@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) Her Majesty the Queen in right of Canada  (2014)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of Her Majesty the Queen in right of Canada nor
+ *   the names of her contributors may be used to endorse or promote
+ *   products derived from this software without specific prior written
+ *   permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * See toplevel COPYING for more information.
+ */
+
+#ifndef TDMAMAC_PCRTABLE_HEADER_
+#define TDMAMAC_PCRTABLE_HEADER_
+
+#include "emane/configurationexception.h"
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace EMANE
+{
+  namespace Models
+  {
+    namespace TDMA
+    {
+      /**
+       *
+       * @struct PCREntry
+       *
+       * @brief proides a direct lookup mapping of packet completion to probability of reception
+       *
+       */
+      struct PCREntry
+      {
+        float fSINR_;
+        float fPOR_;
+
+        PCREntry():
+          fSINR_{},
+          fPOR_{}
+        { }
+
+        /**
+         * @param fSinr the singnal to noise ratio
+         * @param por  the probability of reception
+         */
+        PCREntry(float fSinr, float por):
+          fSINR_{fSinr},
+          fPOR_{por}
+        { }
+      };
+
+      typedef std::vector <PCREntry> PCREntryVector;
+
+      /**
+       * @brief POR (probability of reception) values at 1/100 dB steps
+       */
+      typedef std::vector <float> PORVector;
+
+      /**
+       * @brief steps per dB of the por tables
+       */
+      const int PCR_PRECISION_FACTOR{100};
+
+      /**
+       * @brief packet lengths are grouped in buckets of this many bytes
+       * for the precomputed size adjusted tables
+       */
+      const size_t PCR_SIZE_BUCKET_BYTES{16};
+
+      /**
+       * @brief number of size buckets, longer packets are adjusted per lookup
+       */
+      const size_t PCR_SIZE_BUCKET_COUNT{128};
+
+      /**
+       *
+       * @struct PCRPOR
+       *
+       * @brief curve points of one data rate and packet size and the
+       * interpolated lookup table, the table itself is held by the owning PCRTable
+       *
+       */
+      struct PCRPOR
+      {
+        PCRPOR():
+          packetSize_{},
+          por_{},
+          porCount_{}
+        { }
+
+        std::uint32_t  packetSize_;
+        PCREntryVector pcr_;
+        const float *  por_;
+        size_t         porCount_;
+      };
+
+      /**
+       * @brief curves of one data rate, in increasing packet size
+       */
+      typedef std::vector <PCRPOR> PCRPORVector;
+
+      /**
+       *
+       * @struct PCRRate
+       *
+       * @brief curves of one data rate
+       *
+       */
+      struct PCRRate
+      {
+        /**
+         * @return the curve whose packet size is nearest to packetLen
+         */
+        const PCRPOR & getCurve(size_t packetLen) const;
+
+        /**
+         * @return por of curve at sinrScaled (sinr * PCR_PRECISION_FACTOR),
+         * not adjusted for packet length
+         */
+        static float getPOR(const PCRPOR & curve, int sinrScaled);
+
+        PCRPORVector curves_;
+      };
+
+      /**
+       * @brief map of data rate index to PCRRate
+       */
+      typedef std::map <std::uint16_t, PCRRate> PCRPORMap;
+
+      /**
+       *
+       * @struct PCRRateLookup
+       *
+       * @brief receive path view of one data rate, por already adjusted
+       * to each size bucket, one row of sinr steps per bucket
+       *
+       */
+      struct PCRRateLookup
+      {
+        PCRRateLookup():
+          fSINRLow_{},
+          fSINRHigh_{},
+          sinrOffset_{},
+          sinrCount_{},
+          pPor_{},
+          pRate_{}
+        { }
+
+        // sinr span of all curves, below is full loss, above no loss
+        float fSINRLow_;
+        float fSINRHigh_;
+
+        int sinrOffset_;
+        int sinrCount_;
+
+        // NULL when the data rate has no curve
+        const float * pPor_;
+
+        // curves for lengths past the last bucket
+        const PCRRate * pRate_;
+      };
+
+      /**
+       *
+       * @struct PCRTable
+       *
+       * @brief contents of one pcr curve file, never modified once built
+       * so it can be shared by all NEMs of a process
+       *
+       */
+      struct PCRTable
+      {
+        /**
+         * @return true if u16DataRateIndex has a curve
+         */
+        bool hasDataRate(std::uint16_t u16DataRateIndex) const
+        {
+          return u16DataRateIndex < rateLookup_.size() && rateLookup_[u16DataRateIndex].pPor_;
+        }
+
+        /**
+         * @return the por for sinr, packet length and data rate index,
+         * 0 for a data rate without a curve
+         */
+        float getPOR(float fSINR, size_t packetLen, std::uint16_t u16DataRateIndex) const;
+
+        /**
+         * @brief getPOR of count (sinr, length, data rate index) tuples
+         * given as separate arrays
+         */
+        void getPOR(const float * pSINR,
+                    const size_t * pPacketLen,
+                    const std::uint16_t * pDataRateIndex,
+                    float * pPOR,
+                    size_t count) const;
+
+        PCRPORMap pcrPorMap_;
+
+        // indexed by data rate index
+        std::vector<PCRRateLookup> rateLookup_;
+
+        // size adjusted por of all data rates, each starting cache aligned,
+        // only when built here, a compiled table maps them with the rest
+        std::shared_ptr<float> pSizePor_;
+
+        // backing of the por_ tables: vectors when interpolated here,
+        // a read only mapping when loaded from a compiled file
+        std::vector<PORVector> storage_;
+        std::shared_ptr<const void> pMapping_;
+      };
+
+      /**
+       * @brief Adds curve to its data rate keeping packet size order
+       *
+       * @throw ConfigurationException on a duplicate packet size or a
+       * data rate index the MAC header cannot carry
+       */
+      void addPCRCurve(PCRTable & table, std::uint16_t u16DataRateIndex, const PCRPOR & curve);
+
+      /**
+       * @brief Fills the rate lookup and size adjusted por of every data rate
+       */
+      void buildSizeTables(PCRTable & table);
+
+      /**
+       * @brief true if the file behind uri is a compiled pcr table
+       */
+      bool isPCRBinary(const std::string & uri);
+
+      /**
+       * @brief Maps a compiled pcr table read only, the pages are
+       * shared with every other process mapping the same file
+       *
+       * @throw ConfigurationException
+       */
+      std::shared_ptr<PCRTable> loadPCRBinary(const std::string & uri);
+
+      /**
+       * @brief Writes table in the compiled format, size tables included
+       * so they must have been built
+       *
+       * @throw ConfigurationException
+       */
+      void savePCRBinary(const PCRTable & table, const std::string & path);
+
+      /**
+       *
+       * @class PCRTableCache
+       *
+       * @brief Process wide cache of pcr tables keyed by uri and file
+       * modification time, a curve file is parsed once however many
+       * NEMs use it
+       *
+       */
+      class PCRTableCache
+      {
+      public:
+        typedef std::function<std::shared_ptr<PCRTable>(const std::string &)> Builder;
+
+        static PCRTableCache & instance();
+
+        /**
+         * @brief Returns the cached table for uri, calling build when
+         * there is none or the file changed since it was built
+         *
+         * @throw whatever build throws, nothing is cached then
+         */
+        std::shared_ptr<const PCRTable> get(const std::string & uri, const Builder & build);
+
+      private:
+        struct Entry
+        {
+          timespec mtime_;
+          // tables go away with the last NEM using them
+          std::weak_ptr<const PCRTable> pTable_;
+        };
+
+        PCRTableCache();
+
+        std::mutex lock_;
+        std::map<std::string,Entry> entries_;
+      };
+    }
+  }
+}
+
+#endif // TDMAMAC_PCRTABLE_HEADER_
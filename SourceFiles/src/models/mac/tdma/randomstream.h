@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Her Majesty the Queen in right of Canada  (2014)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of Her Majesty the Queen in right of Canada nor
+ *   the names of her contributors may be used to endorse or promote
+ *   products derived from this software without specific prior written
+ *   permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * See toplevel COPYING for more information.
+ */
+
+#ifndef TDMAMAC_RANDOMSTREAM_HEADER_
+#define TDMAMAC_RANDOMSTREAM_HEADER_
+
+#include "emane/types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace EMANE
+{
+  namespace Models
+  {
+    namespace TDMA
+    {
+      /**
+       *
+       * @class RandomStream
+       *
+       * @brief xoshiro128+ generator of uniform floats, 16 bytes of state
+       * seeded through splitmix64 so a scenario seed gives each NEM and
+       * use its own repeatable stream
+       *
+       */
+      class RandomStream
+      {
+      public:
+        /**
+         * stream uses, part of the derived seed
+         */
+        enum Stream
+        {
+          STREAM_RECEPTION = 1,
+          STREAM_JITTER = 2,
+        };
+
+        explicit RandomStream(std::uint64_t u64Seed)
+        {
+          seed(u64Seed);
+        }
+
+        /**
+         * @brief seed of stream of NEM id under scenario seed
+         */
+        static std::uint64_t deriveSeed(std::uint64_t u64ScenarioSeed, NEMId id, Stream stream)
+        {
+          std::uint64_t u64State{(static_cast<std::uint64_t>(id) << 32) | stream};
+
+          return splitMix64(u64ScenarioSeed) ^ splitMix64(u64State);
+        }
+
+        void seed(std::uint64_t u64Seed)
+        {
+          const std::uint64_t u64First{splitMix64(u64Seed)};
+          const std::uint64_t u64Second{splitMix64(u64Seed)};
+
+          s_[0] = static_cast<std::uint32_t>(u64First);
+          s_[1] = static_cast<std::uint32_t>(u64First >> 32);
+          s_[2] = static_cast<std::uint32_t>(u64Second);
+          s_[3] = static_cast<std::uint32_t>(u64Second >> 32);
+
+          // the all zero state never leaves zero
+          if(!(s_[0] | s_[1] | s_[2] | s_[3]))
+            {
+              s_[0] = 1;
+            }
+        }
+
+        std::uint32_t next()
+        {
+          const std::uint32_t u32Result{s_[0] + s_[3]};
+
+          const std::uint32_t u32Shifted{s_[1] << 9};
+
+          s_[2] ^= s_[0];
+          s_[3] ^= s_[1];
+          s_[1] ^= s_[2];
+          s_[0] ^= s_[3];
+
+          s_[2] ^= u32Shifted;
+
+          s_[3] = (s_[3] << 11) | (s_[3] >> 21);
+
+          return u32Result;
+        }
+
+        /**
+         * @return uniform value in (0,1], so a probability of 0 never
+         * passes a >= test and 1 always does
+         */
+        float uniform()
+        {
+          // the high bits are the better ones of xoshiro128+
+          return ((next() >> 8) + 1) * (1.0f / 16777216.0f);
+        }
+
+        /**
+         * @brief count uniform values in (0,1]
+         */
+        void uniform(float * pValues, size_t count)
+        {
+          for(size_t i = 0; i < count; ++i)
+            {
+              pValues[i] = uniform();
+            }
+        }
+
+      private:
+        std::uint32_t s_[4];
+
+        // advances u64State and returns its next output
+        static std::uint64_t splitMix64(std::uint64_t & u64State)
+        {
+          std::uint64_t z{u64State += 0x9e3779b97f4a7c15ULL};
+
+          z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+          z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+          return z ^ (z >> 31);
+        }
+      };
+    }
+  }
+}
+
+#endif // TDMAMAC_RANDOMSTREAM_HEADER_
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) Her Majesty the Queen in right of Canada  (2014)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of Her Majesty the Queen in right of Canada nor
+ *   the names of her contributors may be used to endorse or promote
+ *   products derived from this software without specific prior written
+ *   permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * See toplevel COPYING for more information.
+ */
+
+#include "slotclaims.h"
+
+#include <algorithm>
+
+EMANE::Models::TDMA::SlotClaims::SlotClaims(NEMId nemId):
+  nemId_{nemId}
+{}
+
+void
+EMANE::Models::TDMA::SlotClaims::resize(size_t slots)
+{
+  claimants_.assign(slots, std::set<NEMId>{});
+  claims_.clear();
+  heard_.clear();
+}
+
+bool
+EMANE::Models::TDMA::SlotClaims::update(NEMId nemId, const SlotList & slots, const TimePoint & heard)
+{
+  SlotList sorted;
+
+  heard_[nemId] = heard;
+
+  sorted.reserve(slots.size());
+
+  // out of range slots come from a NEM configured differently, ignore them
+  for(auto slot : slots)
+    {
+      if(slot < claimants_.size())
+        {
+          sorted.push_back(slot);
+        }
+    }
+
+  std::sort(sorted.begin(), sorted.end());
+
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+  auto iter = claims_.find(nemId);
+
+  if(iter != claims_.end())
+    {
+      if(iter->second == sorted)
+        {
+          return false;
+        }
+
+      for(auto slot : iter->second)
+        {
+          claimants_[slot].erase(nemId);
+        }
+    }
+  else
+    {
+      iter = claims_.insert(std::make_pair(nemId, SlotList{})).first;
+    }
+
+  for(auto slot : sorted)
+    {
+      claimants_[slot].insert(nemId);
+    }
+
+  // a known NEM without claims stays known
+  iter->second.swap(sorted);
+
+  return true;
+}
+
+bool
+EMANE::Models::TDMA::SlotClaims::expire(const TimePoint & before)
+{
+  bool dropped{};
+
+  for(auto iter = claims_.begin(); iter != claims_.end();)
+    {
+      if(iter->first != nemId_ && heard_[iter->first] < before)
+        {
+          for(auto slot : iter->second)
+            {
+              claimants_[slot].erase(iter->first);
+            }
+
+          heard_.erase(iter->first);
+
+          iter = claims_.erase(iter);
+
+          dropped = true;
+        }
+      else
+        {
+          ++iter;
+        }
+    }
+
+  return dropped;
+}
+
+bool
+EMANE::Models::TDMA::SlotClaims::isKnown(NEMId nemId) const
+{
+  return claims_.count(nemId) != 0;
+}
+
+EMANE::NEMId
+EMANE::Models::TDMA::SlotClaims::getOwner(size_t slot) const
+{
+  if(slot >= claimants_.size() || claimants_[slot].empty())
+    {
+      return 0;
+    }
+
+  return *claimants_[slot].begin();
+}
+
+bool
+EMANE::Models::TDMA::SlotClaims::claim(size_t want)
+{
+  SlotList mine;
+
+  for(auto slot : getClaim())
+    {
+      if(mine.size() < want && getOwner(slot) == nemId_)
+        {
+          mine.push_back(slot);
+        }
+    }
+
+  // NEMs joining together start their search at different slots
+  size_t slots{claimants_.size()};
+
+  for(size_t i = 0; i < slots && mine.size() < want; ++i)
+    {
+      size_t slot{(nemId_ + i) % slots};
+
+      if(claimants_[slot].empty())
+        {
+          mine.push_back(slot);
+        }
+    }
+
+  return update(nemId_, mine);
+}
+
+const EMANE::Models::TDMA::SlotList &
+EMANE::Models::TDMA::SlotClaims::getClaim() const
+{
+  auto iter = claims_.find(nemId_);
+
+  return iter != claims_.end() ? iter->second : empty_;
+}
+
+void
+EMANE::Models::TDMA::SlotClaims::fill(SlotTable & table) const
+{
+  for(size_t slot = 0; slot < table.size(); ++slot)
+    {
+      table.setOwner(slot, getOwner(slot));
+    }
+}
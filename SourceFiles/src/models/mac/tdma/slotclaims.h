@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Her Majesty the Queen in right of Canada  (2014)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of Her Majesty the Queen in right of Canada nor
+ *   the names of her contributors may be used to endorse or promote
+ *   products derived from this software without specific prior written
+ *   permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * See toplevel COPYING for more information.
+ */
+
+#ifndef TDMAMAC_SLOTCLAIMS_HEADER_
+#define TDMAMAC_SLOTCLAIMS_HEADER_
+
+#include "emane/types.h"
+#include "tdmaevent.h"
+#include "slottable.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace EMANE
+{
+  namespace Models
+  {
+    namespace TDMA
+    {
+      /**
+       * @class SlotClaims
+       *
+       * @brief Slot claims announced by the NEMs of a subnet when no
+       * manager is used. A slot claimed by several NEMs belongs to the
+       * lowest NEM id, so every NEM that heard the same claims derives
+       * the same owners and a loser moves on to an unclaimed slot.
+       */
+      class SlotClaims
+      {
+      public:
+        /**
+         * @param nemId the NEM whose own claim is kept here
+         */
+        SlotClaims(NEMId nemId);
+
+        /**
+         * @brief Resizes to the configured slot count, drops all claims
+         */
+        void resize(size_t slots);
+
+        /**
+         * @brief Replaces every claim of nemId, an empty list releases all
+         *
+         * @param heard when the claim was received, ours never expires
+         *
+         * @return true if any claim changed
+         */
+        bool update(NEMId nemId, const SlotList & slots, const TimePoint & heard = TimePoint{});
+
+        /**
+         * @brief Forgets every other NEM last heard before the given time
+         *
+         * @return true if any claim was dropped
+         */
+        bool expire(const TimePoint & before);
+
+        bool isKnown(NEMId nemId) const;
+
+        /**
+         * @return lowest claimant of slot, 0 if unclaimed or out of range
+         */
+        NEMId getOwner(size_t slot) const;
+
+        /**
+         * @brief Recomputes our own claim for want slots: slots won are
+         * kept, slots lost are dropped and unclaimed slots are taken
+         * starting from a NEM dependent offset
+         *
+         * @return true if our claim changed and needs announcing
+         */
+        bool claim(size_t want);
+
+        const SlotList & getClaim() const;
+
+        /**
+         * @brief Writes the owner of every slot into table
+         */
+        void fill(SlotTable & table) const;
+
+      private:
+        NEMId nemId_;
+        std::vector<std::set<NEMId>> claimants_;
+        std::map<NEMId,SlotList> claims_;
+        std::map<NEMId,TimePoint> heard_;
+        SlotList empty_;
+      };
+    }
+  }
+}
+
+#endif // TDMAMAC_SLOTCLAIMS_HEADER_
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) Her Majesty the Queen in right of Canada  (2014)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of Her Majesty the Queen in right of Canada nor
+ *   the names of her contributors may be used to endorse or promote
+ *   products derived from this software without specific prior written
+ *   permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * See toplevel COPYING for more information.
+ */
+
+#include "slottable.h"
+
+#include <algorithm>
+
+namespace
+{
+  const size_t WORD_BITS{64};
+}
+
+EMANE::Models::TDMA::SlotTable::SlotTable(NEMId owner):
+  nemId_{owner},
+  owner_{owner}
+{}
+
+void
+EMANE::Models::TDMA::SlotTable::resize(size_t slots)
+{
+  slots_.assign(slots, 0);
+  owned_.assign((slots + WORD_BITS - 1) / WORD_BITS, 0);
+}
+
+size_t
+EMANE::Models::TDMA::SlotTable::size() const
+{
+  return slots_.size();
+}
+
+EMANE::NEMId
+EMANE::Models::TDMA::SlotTable::getOwner(size_t slot) const
+{
+  return slot < slots_.size() ? slots_[slot] : 0;
+}
+
+bool
+EMANE::Models::TDMA::SlotTable::setOwner(size_t slot, NEMId nemId)
+{
+  if(slot >= slots_.size())
+    {
+      return false;
+    }
+
+  slots_[slot] = nemId;
+
+  std::uint64_t bit{std::uint64_t{1} << (slot % WORD_BITS)};
+
+  if(owner_ && nemId == owner_)
+    {
+      owned_[slot / WORD_BITS] |= bit;
+    }
+  else
+    {
+      owned_[slot / WORD_BITS] &= ~bit;
+    }
+
+  return true;
+}
+
+void
+EMANE::Models::TDMA::SlotTable::load(const TdmaBEvent & event)
+{
+  size_t count{event.decodeSlotmap(slots_.data(), slots_.size())};
+
+  const SlotGroups & groups{event.getGroups()};
+
+  if(groups.empty())
+    {
+      owner_ = nemId_;
+    }
+  else
+    {
+      auto iter = std::find_if(groups.begin(), groups.end(),
+                               [this](const std::pair<NEMId,NEMId> & group)
+                               {
+                                 return group.first == nemId_;
+                               });
+
+      // not yet colored, stay silent until the next map
+      owner_ = iter != groups.end() ? iter->second : 0;
+    }
+
+  // a shorter map leaves the remaining slots unassigned
+  if(count < slots_.size())
+    {
+      std::fill(slots_.begin() + count, slots_.end(), 0);
+    }
+
+  reindex();
+}
+
+bool
+EMANE::Models::TDMA::SlotTable::isOwned(size_t slot) const
+{
+  return slot < slots_.size() &&
+    (owned_[slot / WORD_BITS] >> (slot % WORD_BITS)) & 1;
+}
+
+size_t
+EMANE::Models::TDMA::SlotTable::getOwnedCount() const
+{
+  size_t count{};
+
+  for(auto word : owned_)
+    {
+      count += __builtin_popcountll(word);
+    }
+
+  return count;
+}
+
+void
+EMANE::Models::TDMA::SlotTable::reindex()
+{
+  std::fill(owned_.begin(), owned_.end(), 0);
+
+  if(!owner_)
+    {
+      return;
+    }
+
+  for(size_t i = 0; i < slots_.size(); ++i)
+    {
+      if(slots_[i] == owner_)
+        {
+          owned_[i / WORD_BITS] |= std::uint64_t{1} << (i % WORD_BITS);
+        }
+    }
+}
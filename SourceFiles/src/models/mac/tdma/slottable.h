@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Her Majesty the Queen in right of Canada  (2014)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of Her Majesty the Queen in right of Canada nor
+ *   the names of her contributors may be used to endorse or promote
+ *   products derived from this software without specific prior written
+ *   permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * See toplevel COPYING for more information.
+ */
+
+#ifndef TDMAMAC_SLOTTABLE_HEADER_
+#define TDMAMAC_SLOTTABLE_HEADER_
+
+#include "emane/types.h"
+#include "tdmaevent.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace EMANE
+{
+  namespace Models
+  {
+    namespace TDMA
+    {
+      /**
+       * @class SlotTable
+       *
+       * @brief Slot owner table sized from the configured slot count,
+       * with a bitmap of the slots owned by this NEM.
+       *
+       * Under spatial reuse the table holds group ids and this NEM owns
+       * the slots of the group the last full map placed it in.
+       */
+      class SlotTable
+      {
+      public:
+        /**
+         * @param owner the NEM whose slots are tracked in the bitmap
+         */
+        SlotTable(NEMId owner);
+
+        /**
+         * @brief Resizes the table, all slots become unassigned
+         */
+        void resize(size_t slots);
+
+        size_t size() const;
+
+        /**
+         * @return owner of slot, 0 for unassigned or out of range slots
+         */
+        NEMId getOwner(size_t slot) const;
+
+        /**
+         * @return false if slot is out of range
+         */
+        bool setOwner(size_t slot, NEMId nemId);
+
+        /**
+         * @brief Replaces the table with the full map carried by event,
+         * slots beyond the table size are dropped. Also picks up this
+         * NEM's reuse group when the event carries groups.
+         */
+        void load(const TdmaBEvent & event);
+
+        bool isOwned(size_t slot) const;
+
+        size_t getOwnedCount() const;
+
+      private:
+        NEMId nemId_;
+        // token matched against slot entries: nemId_ or reuse group, 0 for none
+        NEMId owner_;
+        std::vector<NEMId> slots_;
+        std::vector<std::uint64_t> owned_;
+
+        void reindex();
+      };
+    }
+  }
+}
+
+#endif // TDMAMAC_SLOTTABLE_HEADER_
@@ -37,20 +37,137 @@
 #include "tdmabevent.pb.h"
 #include "tdmarevent.pb.h"
 
+#include <algorithm>
+
 class EMANE::Models::TDMA::TdmaBEvent::Implementation
  {
    public:
-     Implementation(std::uint64_t slot0time, const SlotMap & slotmap, const std::uint32_t & subid) :
+     Implementation(std::uint64_t slot0time, const SlotMap & slotmap, const std::uint32_t & subid,
+                    std::uint32_t version, B_ENCODING encoding, const SlotGroups & groups) :
+       slot0time_(slot0time),
+       tdmaSubId_(subid),
+       slotmap_{slotmap},
+       groups_{groups},
+       version_(version),
+       baseVersion_(0),
+       delta_(false),
+       encoding_(encoding),
+       runsValid_(false),
+       slotmapValid_(true),
+       activationCycle_(0)
+     { }
+
+     Implementation(std::uint64_t slot0time, const SlotRuns & runs, const std::uint32_t & subid,
+                    std::uint32_t version, B_ENCODING encoding, const SlotGroups & groups) :
        slot0time_(slot0time),
        tdmaSubId_(subid),
-       slotmap_{slotmap}
+       runs_{runs},
+       groups_{groups},
+       version_(version),
+       baseVersion_(0),
+       delta_(false),
+       encoding_(encoding),
+       runsValid_(true),
+       slotmapValid_(false),
+       activationCycle_(0)
      { }
 
+     Implementation(std::uint64_t slot0time, const SlotChanges & changes, const std::uint32_t & subid,
+                    std::uint32_t version, std::uint32_t baseversion, B_ENCODING encoding) :
+       slot0time_(slot0time),
+       tdmaSubId_(subid),
+       changes_{changes},
+       version_(version),
+       baseVersion_(baseversion),
+       delta_(true),
+       encoding_(encoding),
+       runsValid_(false),
+       slotmapValid_(true),
+       activationCycle_(0)
+     { }
+
+     // expanded on first use when the map arrived as runs
      const SlotMap & getSlotMap() const
       {
+        if(!slotmapValid_)
+          {
+            slotmap_.reserve(getSlotCount());
+
+            for(const auto & run : runs_)
+              {
+                slotmap_.insert(slotmap_.end(), run.second, run.first);
+              }
+
+            slotmapValid_ = true;
+          }
+
         return slotmap_;
       }
 
+     const SlotRuns & getRuns() const
+      {
+        if(!runsValid_)
+          {
+            for(const auto & nemid : slotmap_)
+              {
+                if(!runs_.empty() && runs_.back().first == nemid &&
+                   runs_.back().second < UINT16_MAX)
+                  {
+                    ++runs_.back().second;
+                  }
+                else
+                  {
+                    runs_.push_back(std::make_pair(nemid, std::uint16_t{1}));
+                  }
+              }
+
+            runsValid_ = true;
+          }
+
+        return runs_;
+      }
+
+     size_t getSlotCount() const
+      {
+        if(slotmapValid_)
+          {
+            return slotmap_.size();
+          }
+
+        size_t count{};
+
+        for(const auto & run : runs_)
+          {
+            count += run.second;
+          }
+
+        return count;
+      }
+
+     size_t decodeSlotmap(NEMId * table, size_t size) const
+      {
+        if(slotmapValid_)
+          {
+            std::copy_n(slotmap_.begin(), std::min(size, slotmap_.size()), table);
+
+            return slotmap_.size();
+          }
+
+        size_t pos{};
+
+        for(const auto & run : runs_)
+          {
+            if(pos < size)
+              {
+                std::fill_n(table + pos, std::min<size_t>(run.second, size - pos), run.first);
+              }
+
+            pos += run.second;
+          }
+
+        return pos;
+      }
+
      std::uint64_t getSlot0time() const
       {
         return slot0time_;
@@ -61,10 +178,60 @@ class EMANE::Models::TDMA::TdmaBEvent::Implementation
         return tdmaSubId_;
       }
 
+     bool isDelta() const
+      {
+        return delta_;
+      }
+
+     std::uint32_t getVersion() const
+      {
+        return version_;
+      }
+
+     std::uint32_t getBaseVersion() const
+      {
+        return baseVersion_;
+      }
+
+     const SlotChanges & getChanges() const
+      {
+        return changes_;
+      }
+
+     B_ENCODING getEncoding() const
+      {
+        return encoding_;
+      }
+
+     const SlotGroups & getGroups() const
+      {
+        return groups_;
+      }
+
+     std::uint64_t getActivationCycle() const
+      {
+        return activationCycle_;
+      }
+
+     void setActivationCycle(std::uint64_t cycleid)
+      {
+        activationCycle_ = cycleid;
+      }
+
    private:
      std::uint64_t  slot0time_;
      std::uint32_t  tdmaSubId_;
-     SlotMap slotmap_;
+     mutable SlotMap slotmap_;
+     mutable SlotRuns runs_;
+     SlotGroups groups_;
+     SlotChanges changes_;
+     std::uint32_t  version_;
+     std::uint32_t  baseVersion_;
+     bool delta_;
+     B_ENCODING encoding_;
+     mutable bool runsValid_;
+     mutable bool slotmapValid_;
+     std::uint64_t activationCycle_;
  };
 
 
@@ -88,22 +255,116 @@ EMANE::Models::TDMA::TdmaBEvent::TdmaBEvent(const Serialization & serialization)
   
   using RepeatedPtrFieldSlotMap = 
     google::protobuf::RepeatedPtrField<EMANEEventMessage::TdmaBEvent_SlotMapping>;
+
+  B_ENCODING encoding{msg.encoding() == EMANEEventMessage::TdmaBEvent::RUNS ?
+      TDMA_ENCODING_RUNS : TDMA_ENCODING_SLOTS};
+
+  if(msg.groups_size() % 2)
+    {
+      throw SerializationException("unable to deserialize : TdmaBEvent odd slot groups");
+    }
+
+  SlotGroups groups;
+
+  groups.reserve(msg.groups_size() / 2);
+
+  for(int i = 0; i < msg.groups_size(); i += 2)
+    {
+      groups.push_back(std::make_pair(static_cast<NEMId>(msg.groups(i)),
+                                      static_cast<NEMId>(msg.groups(i + 1))));
+    }
   
-  SlotMap mapping;
-  
-  for(const auto & iter : RepeatedPtrFieldSlotMap(msg.mappings()))
+  if(msg.has_baseversion())
+    {
+      SlotChanges changes;
+
+      if(encoding == TDMA_ENCODING_RUNS)
+        {
+          if(msg.packedchanges_size() % 2)
+            {
+              throw SerializationException("unable to deserialize : TdmaBEvent odd packed changes");
+            }
+
+          changes.reserve(msg.packedchanges_size() / 2);
+
+          for(int i = 0; i < msg.packedchanges_size(); i += 2)
+            {
+              changes.push_back(std::make_pair(static_cast<std::uint16_t>(msg.packedchanges(i)),
+                                               static_cast<NEMId>(msg.packedchanges(i + 1))));
+            }
+        }
+      else
+        {
+          changes.reserve(msg.changes_size());
+
+          for(const auto & iter : msg.changes())
+            {
+              changes.push_back(std::make_pair(static_cast<std::uint16_t>(iter.slot()),
+                                               static_cast<NEMId>(iter.nemid())));
+            }
+        }
+
+      pImpl_.reset(new Implementation{static_cast<std::uint64_t>(msg.slotzerotime()), changes,
+                                      static_cast<std::uint32_t>(msg.tdmasubid()),
+                                      static_cast<std::uint32_t>(msg.version()),
+                                      static_cast<std::uint32_t>(msg.baseversion()),
+                                      encoding});
+    }
+  else if(encoding == TDMA_ENCODING_RUNS)
     {
-      mapping.push_back(static_cast<NEMId>(iter.nemid()));
+      if(msg.runs_size() % 2)
+        {
+          throw SerializationException("unable to deserialize : TdmaBEvent odd slot runs");
+        }
+
+      SlotRuns runs;
+
+      runs.reserve(msg.runs_size() / 2);
+
+      for(int i = 0; i < msg.runs_size(); i += 2)
+        {
+          runs.push_back(std::make_pair(static_cast<NEMId>(msg.runs(i)),
+                                        static_cast<std::uint16_t>(msg.runs(i + 1))));
+        }
+
+      pImpl_.reset(new Implementation{static_cast<std::uint64_t>(msg.slotzerotime()), runs,
+                                      static_cast<std::uint32_t>(msg.tdmasubid()),
+                                      static_cast<std::uint32_t>(msg.version()),
+                                      encoding, groups});
+    }
+  else
+    {
+      SlotMap mapping;
+
+      mapping.reserve(msg.mappings_size());
+  
+      for(const auto & iter : RepeatedPtrFieldSlotMap(msg.mappings()))
+        {
+          mapping.push_back(static_cast<NEMId>(iter.nemid()));
+        }
+
+      pImpl_.reset(new Implementation{static_cast<std::uint64_t>(msg.slotzerotime()), mapping,
+                                      static_cast<std::uint32_t>(msg.tdmasubid()),
+                                      static_cast<std::uint32_t>(msg.version()),
+                                      encoding, groups});
     }
 
-  pImpl_.reset(new Implementation{static_cast<std::uint64_t>(msg.slotzerotime()), mapping,
-				  static_cast<std::uint32_t>(msg.tdmasubid())});
+  pImpl_->setActivationCycle(msg.activationcycle());
 }
     
 EMANE::Models::TDMA::TdmaBEvent::TdmaBEvent(std::uint64_t slot0time, 
-				const SlotMap & slotmap, const std::uint32_t & subid):
+				const SlotMap & slotmap, const std::uint32_t & subid,
+				std::uint32_t version, B_ENCODING encoding,
+				const SlotGroups & groups):
+  Event{IDENTIFIER},
+  pImpl_{new Implementation{slot0time, slotmap,subid,version,encoding,groups}}{}
+
+EMANE::Models::TDMA::TdmaBEvent::TdmaBEvent(std::uint64_t slot0time, 
+				const SlotChanges & changes, const std::uint32_t & subid,
+				std::uint32_t version, std::uint32_t baseversion,
+				B_ENCODING encoding):
   Event{IDENTIFIER},
-  pImpl_{new Implementation{slot0time, slotmap,subid}}{}
+  pImpl_{new Implementation{slot0time, changes,subid,version,baseversion,encoding}}{}
 
     
 
@@ -116,6 +377,23 @@ EMANE::Models::TDMA::TdmaBEvent::getSlotmap() const
   return pImpl_->getSlotMap();
 }
 
+size_t
+EMANE::Models::TDMA::TdmaBEvent::decodeSlotmap(NEMId * table, size_t size) const
+{
+  return pImpl_->decodeSlotmap(table, size);
+}
+
+EMANE::Models::TDMA::B_ENCODING
+EMANE::Models::TDMA::TdmaBEvent::getEncoding() const
+{
+  return pImpl_->getEncoding();
+}
+
+const EMANE::Models::TDMA::SlotGroups &
+EMANE::Models::TDMA::TdmaBEvent::getGroups() const
+{
+  return pImpl_->getGroups();
+}
 std::uint64_t
 EMANE::Models::TDMA::TdmaBEvent::getSlot0time() const
 {
@@ -128,6 +406,43 @@ EMANE::Models::TDMA::TdmaBEvent::getSubId() const
   return pImpl_->getSubId();
 }
 
+bool
+EMANE::Models::TDMA::TdmaBEvent::isDelta() const
+{
+  return pImpl_->isDelta();
+}
+
+std::uint32_t
+EMANE::Models::TDMA::TdmaBEvent::getVersion() const
+{
+  return pImpl_->getVersion();
+}
+
+std::uint32_t
+EMANE::Models::TDMA::TdmaBEvent::getBaseVersion() const
+{
+  return pImpl_->getBaseVersion();
+}
+
+const EMANE::Models::TDMA::SlotChanges &
+EMANE::Models::TDMA::TdmaBEvent::getChanges() const
+{
+  return pImpl_->getChanges();
+}
+
+std::uint64_t
+EMANE::Models::TDMA::TdmaBEvent::getActivationCycle() const
+{
+  return pImpl_->getActivationCycle();
+}
+
+void
+EMANE::Models::TDMA::TdmaBEvent::setActivationCycle(std::uint64_t cycleid)
+{
+  pImpl_->setActivationCycle(cycleid);
+}
+
+
 EMANE::Serialization EMANE::Models::TDMA::TdmaBEvent::serialize() const
 {
   Serialization serialization;
@@ -136,12 +451,71 @@ EMANE::Serialization EMANE::Models::TDMA::TdmaBEvent::serialize() const
 
   msg.set_slotzerotime(pImpl_->getSlot0time());
   msg.set_tdmasubid(pImpl_->getSubId());
+  msg.set_version(pImpl_->getVersion());
+
+  if(pImpl_->getActivationCycle())
+    {
+      msg.set_activationcycle(pImpl_->getActivationCycle());
+    }
 
-  for(auto & nemid : pImpl_->getSlotMap())
+  if(pImpl_->getEncoding() == TDMA_ENCODING_RUNS)
     {
-      auto iter = msg.add_mappings();
+      msg.set_encoding(EMANEEventMessage::TdmaBEvent::RUNS);
+    }
+
+  msg.mutable_groups()->Reserve(2 * pImpl_->getGroups().size());
 
-      iter->set_nemid(nemid);
+  for(auto & group : pImpl_->getGroups())
+    {
+      msg.add_groups(group.first);
+      msg.add_groups(group.second);
+    }
+
+  if(pImpl_->isDelta())
+    {
+      msg.set_baseversion(pImpl_->getBaseVersion());
+
+      if(pImpl_->getEncoding() == TDMA_ENCODING_RUNS)
+        {
+          msg.mutable_packedchanges()->Reserve(2 * pImpl_->getChanges().size());
+
+          for(auto & change : pImpl_->getChanges())
+            {
+              msg.add_packedchanges(change.first);
+              msg.add_packedchanges(change.second);
+            }
+        }
+      else
+        {
+          for(auto & change : pImpl_->getChanges())
+            {
+              auto iter = msg.add_changes();
+
+              iter->set_slot(change.first);
+              iter->set_nemid(change.second);
+            }
+        }
+    }
+  else if(pImpl_->getEncoding() == TDMA_ENCODING_RUNS)
+    {
+      const auto & runs = pImpl_->getRuns();
+
+      msg.mutable_runs()->Reserve(2 * runs.size());
+
+      for(auto & run : runs)
+        {
+          msg.add_runs(run.first);
+          msg.add_runs(run.second);
+        }
+    }
+  else
+    {
+      for(auto & nemid : pImpl_->getSlotMap())
+        {
+          auto iter = msg.add_mappings();
+
+          iter->set_nemid(nemid);
+        }
     }
 
   try
@@ -165,13 +539,16 @@ class EMANE::Models::TDMA::TdmaREvent::Implementation
  {
    public:
      Implementation(NEMId id, const R_TYPE & type, const std::string & uuid, const std::uint32_t & subid,
-		    const std::uint32_t & slotnum, const std::uint32_t & slotlen ) :
+		    const std::uint32_t & slotnum, const std::uint32_t & slotlen,
+		    const NeighborList & neighbors, const SlotList & slots) :
        eventSource_(id),
        type_(type),
        uuid_{uuid},
        tdmaSubId_(subid),
        tdmaSlotNum_(slotnum),
-       slotLength_(slotlen)
+       slotLength_(slotlen),
+       neighbors_{neighbors},
+       slots_{slots}
      { }
 
      const R_TYPE & getType() const
@@ -202,6 +579,16 @@ class EMANE::Models::TDMA::TdmaREvent::Implementation
         return eventSource_;
       }
 
+     const NeighborList & getNeighbors() const
+      {
+        return neighbors_;
+      }
+
+     const SlotList & getSlots() const
+      {
+        return slots_;
+      }
+
    private:
      NEMId  eventSource_;
      const R_TYPE type_;
@@ -209,6 +596,8 @@ class EMANE::Models::TDMA::TdmaREvent::Implementation
      std::uint32_t  tdmaSubId_;
      std::uint32_t  tdmaSlotNum_;
      std::uint32_t  slotLength_;
+     const NeighborList neighbors_;
+     const SlotList slots_;
 };
 
 EMANE::Models::TDMA::TdmaREvent::TdmaREvent(const Serialization & serialization)
@@ -229,22 +618,26 @@ EMANE::Models::TDMA::TdmaREvent::TdmaREvent(const Serialization & serialization)
       throw SerializationException("unable to deserialize : TdmaBEvent");
     }
   
-  using RepeatedPtrFieldSlotMap = 
-    google::protobuf::RepeatedPtrField<EMANEEventMessage::TdmaBEvent_SlotMapping>;
-  
+  NeighborList neighbors(msg.neighbors().begin(), msg.neighbors().end());
+
+  SlotList slots(msg.slots().begin(), msg.slots().end());
+
   pImpl_.reset(new Implementation{static_cast<NEMId>(msg.eventsource()),
 				static_cast<R_TYPE>(msg.eventtype()),
 				static_cast<std::string>(msg.uuid()),
 				static_cast<std::uint32_t>(msg.tdmasubid()),
 				static_cast<std::uint32_t>(msg.tdmaslotnum()),
-				static_cast<std::uint32_t>(msg.slotlength())
+				static_cast<std::uint32_t>(msg.slotlength()),
+				neighbors,
+				slots
 				});
 }
     
 EMANE::Models::TDMA::TdmaREvent::TdmaREvent(NEMId id, const R_TYPE & type, const std::string & uuid, 
-	const std::uint32_t & subid, const std::uint32_t & slotnum, const std::uint32_t & slotlen):
+	const std::uint32_t & subid, const std::uint32_t & slotnum, const std::uint32_t & slotlen,
+	const NeighborList & neighbors, const SlotList & slots):
   Event{IDENTIFIER},
-  pImpl_{new Implementation{id,type,uuid,subid,slotnum,slotlen}}{}
+  pImpl_{new Implementation{id,type,uuid,subid,slotnum,slotlen,neighbors,slots}}{}
 
     
 
@@ -269,6 +662,18 @@ EMANE::Models::TDMA::TdmaREvent::getEventSource() const
   return pImpl_->getEventSource();
 }
 
+const EMANE::Models::TDMA::NeighborList &
+EMANE::Models::TDMA::TdmaREvent::getNeighbors() const
+{
+  return pImpl_->getNeighbors();
+}
+
+const EMANE::Models::TDMA::SlotList &
+EMANE::Models::TDMA::TdmaREvent::getSlots() const
+{
+  return pImpl_->getSlots();
+}
+
 std::uint32_t
 EMANE::Models::TDMA::TdmaREvent::getSubId() const
 {
@@ -300,6 +705,16 @@ EMANE::Serialization EMANE::Models::TDMA::TdmaREvent::serialize() const
   msg.set_uuid(pImpl_->getUuid());
   msg.set_slotlength(pImpl_->getSlotLen());
 
+  for(auto & neighbor : pImpl_->getNeighbors())
+    {
+      msg.add_neighbors(neighbor);
+    }
+
+  for(auto & slot : pImpl_->getSlots())
+    {
+      msg.add_slots(slot);
+    }
+
   try
     {
       if(!msg.SerializeToString(&serialization))
@@ -38,8 +38,10 @@
 
 #include "emane/event.h"
 #include "emane/events/eventids.h"
+#include "emane/types.h"
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 
@@ -51,12 +53,38 @@ namespace EMANE
     {
          typedef std::vector<EMANE::NEMId> SlotMap;
 
+         typedef std::vector<std::pair<std::uint16_t,EMANE::NEMId>> SlotChanges;
+
+         typedef std::vector<std::pair<EMANE::NEMId,std::uint16_t>> SlotRuns;
+
+         typedef std::vector<std::pair<EMANE::NEMId,EMANE::NEMId>> SlotGroups;
+
+         typedef std::vector<EMANE::NEMId> NeighborList;
+
+         typedef std::vector<std::uint16_t> SlotList;
+
+         /**
+          * @brief Time on the slot schedule, the clock count since the
+          * epoch like slot0time, which all cycle arithmetic is done in
+          */
+         inline std::uint64_t getScheduleTime(const EMANE::TimePoint & tp)
+         {
+           return tp.time_since_epoch().count();
+         }
+
+         enum B_ENCODING { TDMA_ENCODING_SLOTS = 0x00,
+                           TDMA_ENCODING_RUNS  = 0x01
+                         };
+
          enum R_TYPE  { TDMA_TYPE_INVALID   = 0x00,
                         TDMA_TYPE_INIT      = 0x01,
                         TDMA_TYPE_NOTIFY    = 0x02,
 			TDMA_TYPE_NEMINIT   = 0x03,
 			TDMA_TYPE_FREE_SLOT = 0x04,
-			TDMA_TYPE_REQ_SLOT  = 0x05
+			TDMA_TYPE_REQ_SLOT  = 0x05,
+			TDMA_TYPE_REQ_MAP   = 0x06,
+			TDMA_TYPE_NEIGHBORS = 0x07,
+			TDMA_TYPE_CLAIM     = 0x08
                         };
 
       class TdmaBEvent : public Event
@@ -68,7 +96,19 @@ namespace EMANE
         TdmaBEvent(const std::string & sSerialization)
           throw(SerializationException);
       
-        TdmaBEvent(std::uint64_t slot0time, const SlotMap & slotmap, const std::uint32_t & subid);
+        /**
+         * full slot map snapshot
+         */
+        TdmaBEvent(std::uint64_t slot0time, const SlotMap & slotmap, const std::uint32_t & subid,
+                   std::uint32_t version = 0, B_ENCODING encoding = TDMA_ENCODING_SLOTS,
+                   const SlotGroups & groups = SlotGroups{});
+
+        /**
+         * changed slots only, applies on top of slot map version baseversion
+         */
+        TdmaBEvent(std::uint64_t slot0time, const SlotChanges & changes, const std::uint32_t & subid,
+                   std::uint32_t version, std::uint32_t baseversion,
+                   B_ENCODING encoding = TDMA_ENCODING_SLOTS);
        
         ~TdmaBEvent();
       
@@ -76,10 +116,40 @@ namespace EMANE
       
         const SlotMap & getSlotmap() const;
 
+        /**
+         * writes the full slot map into table, at most size entries
+         *
+         * @return number of slots in the map
+         */
+        size_t decodeSlotmap(NEMId * table, size_t size) const;
+
+        B_ENCODING getEncoding() const;
+
+        /**
+         * spatial reuse group of each NEM, empty when slots are owned by NEMs
+         */
+        const SlotGroups & getGroups() const;
+
         std::uint64_t getSlot0time() const;
       
         std::uint32_t getSubId() const;
 
+        bool isDelta() const;
+
+        std::uint32_t getVersion() const;
+
+        std::uint32_t getBaseVersion() const;
+
+        const SlotChanges & getChanges() const;
+
+        /**
+         * @return cycle at whose start the map takes effect, 0 for the
+         * receiver's next cycle
+         */
+        std::uint64_t getActivationCycle() const;
+
+        void setActivationCycle(std::uint64_t cycleid);
+
         enum {IDENTIFIER = EMANE_EVENT_TDMA_B};
       
       private:
@@ -99,7 +169,9 @@ namespace EMANE
       
         TdmaREvent(NEMId id, const R_TYPE & type, const std::string & uuid, 
 		    const std::uint32_t & subid, const std::uint32_t & slotnum, 
-		    const std::uint32_t & slotlen);
+		    const std::uint32_t & slotlen,
+		    const NeighborList & neighbors = NeighborList{},
+		    const SlotList & slots = SlotList{});
        
         ~TdmaREvent();
       
@@ -116,6 +188,10 @@ namespace EMANE
         std::uint32_t getSlotLen() const;
       
         NEMId getEventSource() const;
+
+        const NeighborList & getNeighbors() const;
+
+        const SlotList & getSlots() const;
       
         enum {IDENTIFIER = EMANE_EVENT_TDMA_R};
       
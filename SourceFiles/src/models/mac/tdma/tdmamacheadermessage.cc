@@ -34,7 +34,8 @@
  */
 
 #include "tdmamacheadermessage.h"
-#include "tdmamacheader.pb.h"
+#include <arpa/inet.h>
+#include <cstring>
 
 
 class EMANE::Models::TDMA::MACHeaderMessage::Implementation
@@ -44,13 +45,15 @@ public:
       sequence_(sequence),
       fragflag_(fragment),
       datarate_(datarate),
-      len_(len)
+      len_(len),
+      total_(0)
     { }
   Implementation():
       sequence_(0),
       fragflag_(0),
       datarate_(0),
-      len_(0)
+      len_(0),
+      total_(0)
     { }
 
     bool isFragment()                           {       return fragflag_!=0;            }
@@ -61,7 +64,9 @@ public:
     std::uint8_t getSequence ()                 {       return sequence_;               }
     std::uint8_t getDataRate()			{	return datarate_;		}
     void setDataRate(std::uint8_t datarate)	{	datarate_ = datarate;		}
-    std::uint8_t getLen()			{	return len_ - 2;		}
+    std::uint8_t getLen()			{	return len_;			}
+    std::uint16_t getTotal()			{	return total_;			}
+    void setTotal(std::uint16_t total)		{	total_ = total;			}
 
 private:
     std::uint8_t        sequence_;         // sequence number
@@ -69,6 +74,8 @@ private:
                                            // 1xxxxxxx last fragment
     std::uint8_t	datarate_;
     std::uint8_t	len_;
+    std::uint16_t	total_;            // total length of a fragmented packet,
+                                           // only carried by the first fragment
 };
 
 
@@ -78,36 +85,22 @@ EMANE::Models::TDMA::MACHeaderMessage::MACHeaderMessage(std::uint8_t sequence, s
 
 EMANE::Models::TDMA::MACHeaderMessage::MACHeaderMessage(const void * p, size_t len) 
 {
-  EMANEMessage::TdmaMACHeader message;
-
-  try
-    {
-      if(!message.ParseFromArray(p, len))
-        {
-          throw SerializationException("unable to deserialize MACHeaderMessage");
-        }
-    }
-  catch(google::protobuf::FatalException & exp)
+  if(len < MACHeaderLayout::SIZE)
     {
       throw SerializationException("unable to deserialize MACHeaderMessage");
     }
 
-  using RepeatedPtrFieldDR = 
-    google::protobuf::RepeatedPtrField<EMANEMessage::TdmaMACHeader_resv>;
-  
-  std::uint8_t dataratem=1;
-  std::uint8_t lenp = 2;
-  
-  for(const auto & iter : RepeatedPtrFieldDR(message.datarate()))
-    {
-     dataratem = (static_cast<std::uint8_t>(iter.byte()));
-     lenp++;
-    }
+  const std::uint8_t * buf = static_cast<const std::uint8_t *>(p);
+
+  std::uint16_t total;
+  memcpy(&total, &buf[MACHeaderLayout::TOTAL], sizeof(total));
 
-  pImpl_.reset(new Implementation{static_cast<std::uint8_t>(message.sequence()),
-					static_cast<std::uint8_t>(message.flag()),
-					dataratem,  lenp});
+  pImpl_.reset(new Implementation{buf[MACHeaderLayout::SEQUENCE],
+					buf[MACHeaderLayout::FLAG],
+					buf[MACHeaderLayout::DATARATE],
+					buf[MACHeaderLayout::LENGTH]});
 
+  pImpl_->setTotal(ntohs(total));
 }
 
 
@@ -161,33 +154,38 @@ std::uint8_t EMANE::Models::TDMA::MACHeaderMessage::getLen()
   return pImpl_->getLen();
 }
 
+std::uint16_t EMANE::Models::TDMA::MACHeaderMessage::getTotal() 
+{
+  return pImpl_->getTotal();
+}
 
-EMANE::Serialization EMANE::Models::TDMA::MACHeaderMessage::serialize() const
+void EMANE::Models::TDMA::MACHeaderMessage::setTotal(std::uint16_t total) 
 {
-  Serialization serialization;
+  pImpl_->setTotal(total);
+}
 
-  try
-    {
-      EMANEMessage::TdmaMACHeader message;
 
-      message.set_sequence(pImpl_->getSequence());
-      message.set_flag(pImpl_->getFlag());
-      for(int i=0;i<pImpl_->getLen();i++)
-    	{
-      	   auto iter = message.add_datarate();
+size_t EMANE::Models::TDMA::MACHeaderMessage::encode(void * p) const
+{
+  std::uint8_t * buf = static_cast<std::uint8_t *>(p);
 
-      	   iter->set_byte(pImpl_->getDataRate());
-    	}
+  buf[MACHeaderLayout::SEQUENCE] = pImpl_->getSequence();
+  buf[MACHeaderLayout::FLAG] = pImpl_->getFlag();
+  buf[MACHeaderLayout::DATARATE] = pImpl_->getDataRate();
+  buf[MACHeaderLayout::LENGTH] = pImpl_->getLen();
+
+  const std::uint16_t total{htons(pImpl_->getTotal())};
+  memcpy(&buf[MACHeaderLayout::TOTAL], &total, sizeof(total));
+
+  return MACHeaderLayout::SIZE;
+}
+
+
+EMANE::Serialization EMANE::Models::TDMA::MACHeaderMessage::serialize() const
+{
+  Serialization serialization(MACHeaderLayout::SIZE, '\0');
+
+  encode(&serialization[0]);
 
-      if(!message.SerializeToString(&serialization))
-        {
-          throw SerializationException("unable to serialize MACHeaderMessage");
-        }
-    }
-  catch(google::protobuf::FatalException & exp)
-    {
-      throw SerializationException("unable to serialize MACHeaderMessage");
-    }
-  
   return serialization;
 }
@@ -49,6 +49,21 @@ namespace EMANE
   {
     namespace TDMA
     {
+      /**
+       * @brief fixed binary layout of the tdma mac header. All fields are
+       * single bytes except the total length which is in network byte order.
+       * LENGTH holds the emulated header length, it is accounted for in the
+       * transmission duration only and never padded onto the wire.
+       */
+      namespace MACHeaderLayout
+      {
+        constexpr size_t SEQUENCE{0};
+        constexpr size_t FLAG{1};
+        constexpr size_t DATARATE{2};
+        constexpr size_t LENGTH{3};
+        constexpr size_t TOTAL{4};
+        constexpr size_t SIZE{6};
+      }
 
       class MACHeaderMessage : public Serializable
       {
@@ -71,6 +86,15 @@ namespace EMANE
     	void setSequence(std::uint8_t sequence);
     	std::uint8_t getSequence();
 	std::uint8_t getLen();
+	std::uint16_t getTotal();
+	void setTotal(std::uint16_t total);
+
+        /**
+         * @brief encodes the header into a buffer of at least MACHeaderLayout::SIZE bytes
+         *
+         * @return number of bytes written
+         */
+        size_t encode(void * buf) const;
 
         Serialization serialize() const override;
      
@@ -86,6 +110,7 @@ namespace EMANE
     	std::uint8_t    fragflag;         
     	std::uint8_t	datarate;
     	std::uint8_t	len;
+    	std::uint16_t	total;          // reassembled length, first fragment only
       };
 
 
@@ -37,9 +37,19 @@
 #include "maclayer.h"
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 namespace
 {
+  // every Nth slot map version is sent as a full snapshot
+  const std::uint32_t FULL_SLOTMAP_INTERVAL{16};
+
+  // a candidate that heard no better INIT within this window takes over
+  const EMANE::Microseconds ELECTION_WINDOW{200000};
+
+  // cycles between an allocation pass and the switch to its map, so
+  // every NEM has the map before the boundary
+  const std::uint64_t ACTIVATION_LEAD_CYCLES{1};
 
 std::vector<std::string> & splitstr(const std::string &s, char delim, std::vector<std::string> &elems) {
     std::stringstream ss(s);
@@ -62,9 +72,13 @@ EMANE::Models::TDMA::TDMAManager::TDMAManager(PlatformServiceProvider *pPlatform
  pPlatformService_(pPlatformServiceProvider),
  isTdmaManager_(true),
  isTdmaInited_(false),
+ networks_{},
+ networksLock_{},
  dyn_send_timer_{},
- dyn_timer_{},
- dyn_net_{}
+ timerLock_{},
+ eventProxy_(NULL),
+ proxyNid_(0),
+ proxyGeneration_(0)
 {
 }
 EMANE::Models::TDMA::TDMAManager::~TDMAManager()
@@ -77,26 +91,70 @@ void EMANE::Models::TDMA::TDMAManager::setInited()      { isTdmaInited_ = true;
 bool EMANE::Models::TDMA::TDMAManager::isInited()       { return isTdmaInited_;   }
 EMANE::NEMId EMANE::Models::TDMA::TDMAManager::getPid()	{ return proxyNid_;	  }
 
-void EMANE::Models::TDMA::TDMAManager::initialize(std::auto_ptr<EMANE::Models::TDMA::MACLayer> eventproxy, NEMId nid)
+void EMANE::Models::TDMA::TDMAManager::initialize(EMANE::Models::TDMA::MACLayer * eventproxy, NEMId nid)
 {
+    std::lock_guard<std::recursive_mutex> m(lock_);
     eventProxy_ = eventproxy;
     proxyNid_ = nid;
     // send TDMA R INIT event
     auto timeNow = Clock::now();
     if (isManager() && ! isInited()) {
        char uuidBuf[37];
-       sprintf(uuidBuf,"TDMA-M%u",proxyNid_);
+       sprintf(uuidBuf,"TDMA-M%u",nid);
 
        sendInitEvent(std::string{uuidBuf});
 
-       LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+       LOGGER_STANDARD_LOGGING(pPlatformService_.load()->logService(),
                           INFO_LEVEL,
                           "TDMAManager::initialize %s",
                           "tdma init timer start");
-       auto time1S = Microseconds(1000000);
 
-       pPlatformService_->timerService().
-              scheduleTimedEvent(timeNow+time1S,NULL);
+       pPlatformService_.load()->timerService().
+              scheduleTimedEvent(timeNow+ELECTION_WINDOW,NULL);
+    }
+}
+
+void EMANE::Models::TDMA::TDMAManager::setProxy(EMANE::Models::TDMA::MACLayer * eventproxy, NEMId nid,
+						 PlatformServiceProvider *pPlatformServiceProvider)
+{
+    // runs on the leaving layer's thread, hand the swap to the new proxy's
+    // thread so the state it owns is never touched from two threads
+    std::uint32_t generation = ++proxyGeneration_;
+    pPlatformServiceProvider->timerService().
+    scheduleTimedEvent(Clock::now(),
+		       new std::function<bool()>{[this,eventproxy,nid,pPlatformServiceProvider,generation]()
+			 {
+			   // a later handoff supersedes this one
+			   if (generation == proxyGeneration_) {
+			     takeProxy(eventproxy,nid,pPlatformServiceProvider);
+			   }
+			   return true;
+			 }});
+}
+
+void EMANE::Models::TDMA::TDMAManager::takeProxy(EMANE::Models::TDMA::MACLayer * eventproxy, NEMId nid,
+						  PlatformServiceProvider *pPlatformServiceProvider)
+{
+    std::lock_guard<std::recursive_mutex> m(lock_);
+    eventProxy_ = eventproxy;
+    proxyNid_ = nid;
+    pPlatformService_ = pPlatformServiceProvider;
+
+    // timers of the old proxy never fire here, re-arm them on the new one so
+    // subnet state is still only touched on the proxy's thread
+    std::map<TimerEventId,std::uint16_t> pending;
+    timerLock_.lock();
+    pending.swap(dyn_send_timer_);
+    for (auto & timer : pending) {
+	TimerEventId eventid = pPlatformServiceProvider->timerService().
+	scheduleTimedEvent(Clock::now(),NULL);
+	dyn_send_timer_[eventid] = timer.second;
+    }
+    timerLock_.unlock();
+
+    if (isManager() && ! isInited()) {
+       pPlatformServiceProvider->timerService().
+              scheduleTimedEvent(Clock::now()+ELECTION_WINDOW,NULL);
     }
 }
 
@@ -104,7 +162,7 @@ void EMANE::Models::TDMA::TDMAManager::sendInitEvent(std::string uuid)
 {
      strUuid_ = uuid;
      EMANE::Models::TDMA::TdmaREvent event(0,EMANE::Models::TDMA::TDMA_TYPE_INIT,uuid,0,0,0);
-     eventProxy_->proxyEvent(0,0,event);
+     eventProxy_.load()->proxyEvent(0,0,event);
 }
 
 void
@@ -114,47 +172,120 @@ EMANE::Models::TDMA::TDMAManager::processTimedEvent(TimerEventId eventid,
                                                          const TimePoint &,
                                                          const void *)
 {
-  if (dyn_timer_.find(eventid)==dyn_timer_.end()) {
+  timerLock_.lock();
+  auto iter = dyn_send_timer_.find(eventid);
+  bool dyntimer = iter != dyn_send_timer_.end();
+  std::uint16_t subid = dyntimer ? iter->second : 0;
+  if (dyntimer) dyn_send_timer_.erase(iter);
+  timerLock_.unlock();
+
+  if (!dyntimer) {
+    std::lock_guard<std::recursive_mutex> m(lock_);
     if (!isTdmaInited_) {
       isTdmaInited_ = true;
       if (isTdmaManager_) {
 	auto timeNow = Clock::now();
-	slotBaseTime_ = (timeNow).time_since_epoch().count();
+	slotBaseTime_ = getScheduleTime(timeNow);
 	// declear self as a manager
      	EMANE::Models::TDMA::TdmaREvent event(0,EMANE::Models::TDMA::TDMA_TYPE_NOTIFY,strUuid_,0,0,0);
-        eventProxy_->proxyEvent(0,0,event);
+        eventProxy_.load()->proxyEvent(0,0,event);
       }
     }
-    LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+    LOGGER_STANDARD_LOGGING(pPlatformService_.load()->logService(),
 	                          INFO_LEVEL,
 	                          "TDMAManager::processTimedEvent tdma init timer exec. Manager? %s",
 	                          isTdmaManager_?"Yes":"No");
   }
   else {
      // dynamic send slot
-     dyn_timer_.erase(eventid);
-     if (dyn_send_timer_.find(eventid) != dyn_send_timer_.end()) {
-   	std::uint16_t netid = dyn_send_timer_[eventid];
-	dyn_send_timer_.erase(eventid);
-	sendSlotMap(networks_[netid]);
-	if (dyn_net_.find(netid) != dyn_net_.end())
-	    dyn_net_.erase(netid);
+     Subnet * subnet = getSubnet(subid);
+     if (subnet != NULL) {
+	subnet->dynPending_ = false;
+	// one allocation pass for all requests of the last window
+	subnet->slotmap_.allocate();
+	sendSlotMap(subnet->slotmap_,false,subnet->activationCycle_);
      }
   }
 }
 
+EMANE::Models::TDMA::TDMAManager::Subnet * 
+EMANE::Models::TDMA::TDMAManager::getSubnet(std::uint16_t subid)
+{
+	std::lock_guard<std::mutex> m(networksLock_);
+	auto iter = networks_.find(subid);
+	return iter != networks_.end() ? iter->second.get() : NULL;
+}
+
+EMANE::Models::TDMA::TDMAManager::Subnet * 
+EMANE::Models::TDMA::TDMAManager::addSubnet(std::uint16_t subid, std::uint16_t slotnum, std::uint32_t slotlen)
+{
+	std::lock_guard<std::mutex> m(networksLock_);
+	auto & subnet = networks_[subid];
+	if (!subnet) {
+	    subnet.reset(new Subnet{subid,slotnum});
+	    subnet->slotmap_.setSlotLen(slotlen);
+	}
+	return subnet.get();
+}
+
 void 
-EMANE::Models::TDMA::TDMAManager::sendSlotMap(TDMASlotMap & slotmap)
+EMANE::Models::TDMA::TDMAManager::join(TDMASlotMap & slotmap, NEMId nodeid, const std::string & cfgstr)
 {
-     	EMANE::Models::TDMA::TdmaBEvent event(slotBaseTime_,slotmap.getMap(),slotmap.getSubId());
-        eventProxy_.get()->proxyEvent(0,0,event);
+	std::uint16_t slotnum = slotmap.getSlotNum();
+	if (cfgstr.length()>0) {
+	    std::vector<std::string> slots = splitstr(cfgstr,',');
+	    for (std::uint16_t k=0;k<slots.size();k++) {
+		int slot = atoi(slots[k].c_str())-1;
+		if (slot < 0 || slot >= slotnum) continue;
+		NEMId nid = slotmap.getOwner(slot);
+		if (nid != 0 && nid != nodeid) {
+		    // slot used, move it another empty one
+		    std::int32_t m = slotmap.getUnowned();
+		    if (m >= 0) slotmap.setOwner(m,nid);
+		}
+		slotmap.setOwner(slot,nodeid);
+	    }
+	}
+	else if (slotmap.getUsedNum(nodeid) == 0) {
+	    // a repeated NEMINIT keeps the slots already given
+	    std::int32_t k = slotmap.getUnowned();
+	    if (k >= 0) slotmap.setOwner(k,nodeid);
+	}
+}
+
+void 
+EMANE::Models::TDMA::TDMAManager::sendSlotMap(TDMASlotMap & slotmap, bool full, std::uint64_t activation)
+{
+	SlotChanges changes{slotmap.getChanges()};
+
+	bool reuse = slotmap.isReuse();
+	if (changes.empty() && !full && !(reuse && slotmap.groupsChanged())) return;	// nothing new to tell
+
+	std::uint32_t base = slotmap.getVersion();
+	if (!changes.empty() || base == 0 || slotmap.groupsChanged()) slotmap.publish();
+	std::uint32_t version = slotmap.getVersion();
+
+	// the groups only travel with a full map
+	if (full || reuse || base == 0 || version % FULL_SLOTMAP_INTERVAL == 0 || changes.size() > slotmap.getSlotNum()/2u) {
+     	    EMANE::Models::TDMA::TdmaBEvent event(slotBaseTime_,slotmap.getMap(),slotmap.getSubId(),version,
+							  TDMA_ENCODING_RUNS,
+							  reuse ? slotmap.getGroups() : SlotGroups{});
+	    event.setActivationCycle(activation);
+            eventProxy_.load()->proxyEvent(0,0,event);
+	}
+	else {
+     	    EMANE::Models::TDMA::TdmaBEvent event(slotBaseTime_,changes,slotmap.getSubId(),version,base,
+							  TDMA_ENCODING_RUNS);
+	    event.setActivationCycle(activation);
+            eventProxy_.load()->proxyEvent(0,0,event);
+	}
 }
 
 void
 EMANE::Models::TDMA::TDMAManager::processEventTDMA(const EventId & eventId,
                                                     const Serialization & serialization)
 {
-   LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
+   LOGGER_STANDARD_LOGGING(pPlatformService_.load()->logService(),
 	                          DEBUG_LEVEL,
 	                          "TDMAManager::processEvent %s %hu %s %s",
 	                          "event id: ",eventId,(isTdmaInited_?"InitOK":"NotInit"),(isTdmaManager_?"Manager":"Null"));
@@ -174,129 +305,75 @@ EMANE::Models::TDMA::TDMAManager::processEventTDMA(const EventId & eventId,
 		    std::uint16_t slotnum = revent.getSlotNum();
 		    std::uint32_t slotlen = revent.getSlotLen();
 		    std::string cfgstr = revent.getUuid(); // para reused
-		    bool exist = false;
-		    for (std::uint16_t i=0;i<networks_.size();i++) {
-			    if (networks_[i].getSubId()==subid) {
-				exist = true;
-				if (networks_[i].getSlotNum() != slotnum) {
-				    // error
-   				    LOGGER_STANDARD_LOGGING(pPlatformService_->logService(),
-	                          	ERROR_LEVEL,
-	                          	"TDMAManager::processEvent %s nodeid: %u subid: %u slot#: %u newSlot#: %u",
-	                          	"slot num does not match: ",nodeid,subid,networks_[i].getSlotNum(),slotnum);
-				}
-				else {
-				    if (cfgstr.length()>0) {
-					std::vector<std::string> slots = splitstr(cfgstr,',');
-				        for (std::uint16_t k=0;k<slots.size();k++) {
-					   if (networks_[i].getOwner(atoi(slots[k].c_str())-1) == 0) {
-					      networks_[i].setOwner(atoi(slots[k].c_str())-1,nodeid);
-					   }
-					   else {
-						std::uint16_t nid = networks_[i].getOwner(atoi(slots[k].c_str())-1);
-						if (nid!=nodeid)
-						  // slot used, move it another empty one
-				      		  for (int m=0;m<slotnum;m++) {
-						   if (networks_[i].getOwner(m) == 0) {
-					    	      networks_[i].setOwner(m,nid);
-					   	       break;
-						   }
-				      		  }
-					      networks_[i].setOwner(atoi(slots[k].c_str())-1,nodeid);
-					   }
-				        }
-				    }
-				    else {
-				      for (int k=0;k<slotnum;k++) {
-					if (networks_[i].getOwner(k) == 0) {
-					    networks_[i].setOwner(k,nodeid);
-					    break;
-					}
-				      }
-				    }
-				    sendSlotMap(networks_[i]);
-				}
-				break;
-			    }
+		    Subnet * subnet = addSubnet(subid,slotnum,slotlen);
+		    if (subnet->slotmap_.getSlotNum() != slotnum) {
+			// error
+   			LOGGER_STANDARD_LOGGING(pPlatformService_.load()->logService(),
+	                      	ERROR_LEVEL,
+	                      	"TDMAManager::processEvent %s nodeid: %u subid: %u slot#: %u newSlot#: %u",
+	                      	"slot num does not match: ",nodeid,subid,subnet->slotmap_.getSlotNum(),slotnum);
 		    }
-		    if (! exist) {
-			TDMASlotMap slotmap(subid,slotnum);
-			slotmap.setSlotLen(slotlen);
-			networks_.push_back(slotmap);
-			if (cfgstr.length()>0) {
-				std::vector<std::string> slots = splitstr(cfgstr,',');
-				for (std::uint16_t k=0;k<slots.size();k++) {
-					if (networks_[0].getOwner(atoi(slots[k].c_str())-1) == 0) {
-					      networks_[0].setOwner(atoi(slots[k].c_str())-1,nodeid);
-					}
-					else {
-						std::uint16_t nid = networks_[0].getOwner(atoi(slots[k].c_str())-1);
-						if (nid!=nodeid)
-						  // slot used, move it another empty one
-				      		  for (int m=0;m<slotnum;m++) {
-						      if (networks_[0].getOwner(m) == 0) {
-					    	          networks_[0].setOwner(m,nid);
-					   	          break;
-						      }
-				      		  }
-					          networks_[0].setOwner(atoi(slots[k].c_str())-1,nodeid);
-					   }
-				        }
-				    }
-			else {
-				for (int k=0;k<slotnum;k++) {
-					if (networks_[0].getOwner(k) == 0) {
-					    networks_[0].setOwner(k,nodeid);
-					    break;
-				      	}
-				}
-			}
-			sendSlotMap(slotmap);
+		    else if (subnet->slotmap_.isReuse()) {
+			// slots are per group, a configured slot list does not apply
+			subnet->slotmap_.addMember(nodeid);
+			subnet->slotmap_.allocate();
+			sendSlotMap(subnet->slotmap_,true,subnet->activation());
+		    }
+		    else {
+			join(subnet->slotmap_,nodeid,cfgstr);
+			sendSlotMap(subnet->slotmap_,true,subnet->activation());
 		    }
 		}
 		else if (EMANE::Models::TDMA::TDMA_TYPE_FREE_SLOT == revent.getType()) {
 		    NEMId nodeid = revent.getEventSource();
-		    std::uint16_t subid = revent.getSubId();
 		    std::uint32_t dynlen = revent.getSlotLen();  // dynamic overhead
-		    for (std::uint16_t i=0;i<networks_.size();i++) {
-			if (networks_[i].getSubId()==subid) {
-			    networks_[i].free(nodeid);
-			    if (networks_[i].needReassign()) {
-				if (networks_[i].reassign(0,0))
-				    setDynTimer(i,dynlen);
-			    }
-			    break;
-			}
+		    Subnet * subnet = getSubnet(revent.getSubId());
+		    if (subnet != NULL) {
+			// only recorded here, allocate() runs once per cycle
+			subnet->slotmap_.free(nodeid);
+			setDynTimer(*subnet,dynlen);
 		    }
 		}
 		else if (EMANE::Models::TDMA::TDMA_TYPE_REQ_SLOT == revent.getType()) {
 		    NEMId nodeid = revent.getEventSource();
-		    std::uint16_t subid = revent.getSubId();
 		    std::uint16_t slot = revent.getSlotNum();	// required slot
 		    std::uint32_t dynlen = revent.getSlotLen();  // dynamic overhead
-		    for (std::uint16_t i=0;i<networks_.size();i++) {
-			if (networks_[i].getSubId()==subid) {
-			    std::uint16_t usedslot = networks_[i].getUsedNum(nodeid);
-			    networks_[i].setReqNum(nodeid,slot);
-			    if (slot>usedslot) {
-				if (networks_[i].reassign(slot-usedslot,nodeid))
-				    setDynTimer(i,dynlen);
-			    }
-			    break;
-			}
+		    Subnet * subnet = getSubnet(revent.getSubId());
+		    if (subnet != NULL) {
+			subnet->slotmap_.setReqNum(nodeid,slot);
+			setDynTimer(*subnet,dynlen);
+		    }
+		}
+		else if (EMANE::Models::TDMA::TDMA_TYPE_NEIGHBORS == revent.getType()) {
+		    NEMId nodeid = revent.getEventSource();
+		    std::uint32_t dynlen = revent.getSlotLen();  // dynamic overhead
+		    Subnet * subnet = getSubnet(revent.getSubId());
+		    if (subnet != NULL) {
+			// recolored at the next allocate()
+			subnet->slotmap_.setNeighbors(nodeid,revent.getNeighbors());
+			setDynTimer(*subnet,dynlen);
+		    }
+		}
+		else if (EMANE::Models::TDMA::TDMA_TYPE_REQ_MAP == revent.getType()) {
+		    // a node missed a slot map version, resend a full snapshot
+		    Subnet * subnet = getSubnet(revent.getSubId());
+		    if (subnet != NULL) {
+			sendSlotMap(subnet->slotmap_,true,subnet->activation());
 		    }
 		}
 		else {
 		    // notify other
+		    std::lock_guard<std::recursive_mutex> m(lock_);
      		    if (strUuid_.compare(revent.getUuid())!=0) {
      		        EMANE::Models::TDMA::TdmaREvent event(0,EMANE::Models::TDMA::TDMA_TYPE_NOTIFY,strUuid_,0,0,0);
-			eventProxy_->proxyEvent(0,0,event);
+			eventProxy_.load()->proxyEvent(0,0,event);
 		    }
 		}
 	    }
 	}
 	else {
 	    // during initial phase
+	    std::lock_guard<std::recursive_mutex> m(lock_);
 	    if (isTdmaManager_) {
 		switch (revent.getType())
 		{
@@ -312,7 +389,7 @@ EMANE::Models::TDMA::TDMAManager::processEventTDMA(const EventId & eventId,
 		    }
 		    else if (strUuid_.compare(revent.getUuid())!=0) {
      			EMANE::Models::TDMA::TdmaREvent event(0,EMANE::Models::TDMA::TDMA_TYPE_INIT,strUuid_,0,0,0);
-    			eventProxy_->proxyEvent(0,0,event);
+    			eventProxy_.load()->proxyEvent(0,0,event);
 		    }
 		    break;
 		default:
@@ -328,133 +405,393 @@ EMANE::Models::TDMA::TDMAManager::processEventTDMA(const EventId & eventId,
 }
 
 void 
-EMANE::Models::TDMA::TDMAManager::setDynTimer(std::uint16_t netid, std::uint32_t dynlen)
+EMANE::Models::TDMA::TDMAManager::setDynTimer(Subnet & subnet, std::uint32_t dynlen)
 {
-    if (dyn_net_.find(netid) != dyn_net_.end()) return;
+    if (subnet.dynPending_) return;
 
-    TDMASlotMap slot = networks_[netid];
-    std::uint16_t slotnum = slot.getSlotNum();
-    std::uint32_t slotlen = slot.getSlotLen();
+    std::uint16_t slotnum = subnet.slotmap_.getSlotNum();
+    std::uint32_t slotlen = subnet.slotmap_.getSlotLen();
     // calculate next cycle start time
     // get current time
     TimePoint timeNow{Clock::now()};
 
-    std::uint64_t nowus = (timeNow).time_since_epoch().count()+10;
+    std::uint64_t nowus = getScheduleTime(timeNow)+10;
     std::uint64_t cycleid = (nowus - slotBaseTime_)/(dynlen+slotlen*slotnum);
     std::uint64_t nextcycle = slotBaseTime_+(cycleid+1)*(dynlen+slotlen*slotnum);
 
-    dyn_net_.insert(netid);
+    subnet.dynPending_ = true;
+    // the timer fires at the start of cycleid+1
+    subnet.activationCycle_ = cycleid+1+ACTIVATION_LEAD_CYCLES;
     auto timenext = Microseconds(nextcycle-nowus);
-    TimerEventId eventid = pPlatformService_->timerService().
+    std::lock_guard<std::mutex> m(timerLock_);
+    TimerEventId eventid = pPlatformService_.load()->timerService().
     scheduleTimedEvent(timeNow+timenext,NULL);
-    dyn_send_timer_[eventid] = netid;
-    dyn_timer_.insert(eventid);
+    dyn_send_timer_[eventid] = subnet.slotmap_.getSubId();
+}
+
+//============================== TDMAManagerRegistry ======================================
+
+EMANE::Models::TDMA::TDMAManagerRegistry::TDMAManagerRegistry() :
+	lock_{},
+	manager_{},
+	members_{},
+	proxy_(0)
+{
+}
+
+EMANE::Models::TDMA::TDMAManagerRegistry & 
+EMANE::Models::TDMA::TDMAManagerRegistry::instance()
+{
+	static TDMAManagerRegistry registry;
+	return registry;
+}
+
+EMANE::Models::TDMA::TDMAManager * 
+EMANE::Models::TDMA::TDMAManagerRegistry::registerLayer(MACLayer * layer, NEMId nid,
+							 PlatformServiceProvider *pPlatformServiceProvider)
+{
+	std::lock_guard<std::mutex> m(lock_);
+	members_.push_back(Member{layer,nid,pPlatformServiceProvider});
+	if (!manager_) {
+	    manager_.reset(new TDMAManager{pPlatformServiceProvider});
+	    manager_->initialize(layer,nid);
+	    proxy_ = nid;
+	}
+	return manager_.get();
+}
+
+void 
+EMANE::Models::TDMA::TDMAManagerRegistry::unregisterLayer(MACLayer * layer)
+{
+	std::lock_guard<std::mutex> m(lock_);
+	for (auto iter = members_.begin(); iter != members_.end(); ++iter) {
+	    if (iter->layer_ == layer) {
+		// the manager only learns of a new proxy on that proxy's thread
+		bool proxy = manager_ && iter->nid_ == proxy_;
+		members_.erase(iter);
+		if (members_.empty()) {
+		    manager_.reset();
+		}
+		else if (proxy) {
+		    proxy_ = members_.front().nid_;
+		    manager_->setProxy(members_.front().layer_,members_.front().nid_,
+				       members_.front().pPlatformService_);
+		}
+		break;
+	    }
+	}
 }
 
 //================================= TDMASlotMap ==========================================
 
+
 EMANE::Models::TDMA::TDMASlotMap::TDMASlotMap(std::uint16_t id, std::uint16_t num) :
 	sub_id_(id),
 	slot_a_cycle_(num),
-	used_slot_{},
-	avai_slot_{},
+	used_slot_(num,0),
+	avai_slot_(num,0),
 	reqed_slot_{},
+	node_slot_{},
+	free_slot_{},
+	dirty_slot_{},
 	slot_length_(0),
-	dynamic_(false)
+	dynamic_(false),
+	published_slot_(num,0),
+	version_(0),
+	pending_(false),
+	reuse_(false),
+	neighbors_{},
+	groups_{},
+	groupsChanged_(false)
 {
-  used_slot_.resize(num);
-  for (int i=0;i<num;i++) used_slot_[i] = 0;
-  avai_slot_.resize(num);
-  for (int i=0;i<num;i++) avai_slot_[i] = 0;
+  for (std::uint16_t i=0;i<num;i++) free_slot_.insert(free_slot_.end(),i);
 }
 EMANE::Models::TDMA::TDMASlotMap::~TDMASlotMap() 
 {
 }
 
+void 
+EMANE::Models::TDMA::TDMASlotMap::assign(std::uint16_t slot, EMANE::NEMId owner)
+{
+  EMANE::NEMId old = used_slot_[slot];
+  if (old != owner) {
+    if (old != 0) {
+      auto iter = node_slot_.find(old);
+      iter->second.erase(slot);
+      if (iter->second.empty()) node_slot_.erase(iter);
+    }
+    if (owner != 0) node_slot_[owner].insert(slot);
+    used_slot_[slot] = owner;
+    dirty_slot_.insert(slot);
+  }
+  avai_slot_[slot] = 0;
+  if (owner == 0) free_slot_.insert(slot);
+  else free_slot_.erase(slot);
+}
+
 std::uint16_t 
 EMANE::Models::TDMA::TDMASlotMap::getUsedNum(EMANE::NEMId nodeid)
 {
-  std::uint16_t ret = 0;
-  for (int i=0;i< slot_a_cycle_;i++) if (used_slot_[i] == nodeid) ret++;
-  return ret;
+  auto iter = node_slot_.find(nodeid);
+  return iter != node_slot_.end() ? iter->second.size() : 0;
 }
 
 void 
 EMANE::Models::TDMA::TDMASlotMap::free(EMANE::NEMId nodeid)
 {
-  for (int i=0;i< slot_a_cycle_;i++) {
-    if (used_slot_[i] == nodeid) {
-	avai_slot_[i] = nodeid;
+  if (reuse_) {
+    // slots belong to groups, just drop to the minimum demand
+    reqed_slot_[nodeid] = 1;
+    pending_ = true;
+    return;
+  }
+  // nothing wanted until its next request
+  reqed_slot_[nodeid] = 0;
+  auto iter = node_slot_.find(nodeid);
+  if (iter != node_slot_.end()) {
+    // still used by nodeid until somebody else takes them
+    for (auto slot : iter->second) {
+      avai_slot_[slot] = nodeid;
+      free_slot_.insert(slot);
     }
   }
+  pending_ = true;
 }
 
 bool 
 EMANE::Models::TDMA::TDMASlotMap::needReassign()
 {
-    bool ret = false;
-    std::uint16_t used;
-    for (std::map<EMANE::NEMId,std::uint16_t>::iterator it = reqed_slot_.begin(); it != reqed_slot_.end(); ++it) {
-	used = getUsedNum(it->first);
-	if (it->second>used) {
-	    ret = true;
-	    break;
+    for (auto & req : reqed_slot_) {
+	if (req.second>getUsedNum(req.first)) return true;
+    }
+    return false;
+}
+
+std::int32_t 
+EMANE::Models::TDMA::TDMASlotMap::getUnowned()
+{
+    for (auto slot : free_slot_) {
+	if (used_slot_[slot] == 0) return slot;
+    }
+    return -1;
+}
+
+bool 
+EMANE::Models::TDMA::TDMASlotMap::allocate()
+{
+    if (!pending_) return false;
+    pending_ = false;
+
+    if (reuse_) {
+	colorAndAssign();
+	return true;
+    }
+
+    // released slots still name their holder, give a requester its own back
+    // first so the walk below only hands out slots held by somebody else
+    for (auto & req : reqed_slot_) {
+	auto iter = node_slot_.find(req.first);
+	if (req.second == 0 || iter == node_slot_.end()) continue;
+	std::uint16_t kept = 0;
+	for (auto slot : iter->second) {
+	    if (avai_slot_[slot] != req.first) kept++;
+	}
+	for (auto slot : iter->second) {
+	    if (kept >= req.second) break;
+	    if (avai_slot_[slot] == req.first) {
+		avai_slot_[slot] = 0;
+		free_slot_.erase(slot);
+		kept++;
+	    }
 	}
     }
-    return ret;
+
+    // everything asked for this round, then one pass over the free slots
+    std::vector<std::pair<EMANE::NEMId,std::uint16_t>> demand;
+    std::uint32_t shortfall = 0;
+    for (auto & req : reqed_slot_) {
+	std::uint16_t used = getUsedNum(req.first);
+	if (req.second>used) {
+	    demand.push_back(std::make_pair(req.first,req.second-used));
+	    shortfall += req.second-used;
+	}
+    }
+    if (shortfall == 0) return false;
+
+    if (shortfall > free_slot_.size()) {
+	reassign(0,0);
+	return true;
+    }
+
+    // lowest free or released slots first, assign() drops each from free_slot_
+    auto slot = free_slot_.begin();
+    for (auto & req : demand) {
+	for (std::uint16_t k=0;k<req.second;k++) {
+	    std::uint16_t next = *slot++;
+	    assign(next,req.first);
+	}
+    }
+    return true;
 }
 
 bool 
 EMANE::Models::TDMA::TDMASlotMap::reassign(std::uint16_t need, EMANE::NEMId nodeid)
 {
-    std::uint16_t freeslot = 0;
-    for (int i=0;i< slot_a_cycle_;i++) if (avai_slot_[i]>0 || used_slot_[i]==0) freeslot++;
     if (need>0 && nodeid!=0) {
-	if (need<=freeslot) {
+	if (need<=free_slot_.size()) {
+	    // lowest free or released slots first
 	    for (int k=0;k<need;k++) {
-		for (int i=0;i< slot_a_cycle_;i++) {
-		    if (avai_slot_[i]>0) {
-			avai_slot_[i] = 0;  used_slot_[i] = nodeid;  break;
-		    } else if(used_slot_[i]==0) {
-			 used_slot_[i] = nodeid;   break;
-		    }
-		}
+		assign(*free_slot_.begin(),nodeid);
 	    }
 	    return true;
 	}
     }
-    // complete re-assign
-    size_t nodenum = reqed_slot_.size();
-    EMANE::NEMId *nlist = new EMANE::NEMId[nodenum];
-    std::uint16_t *reqlist = new std::uint16_t[nodenum];
-    int x = 0;
-    for (std::map<EMANE::NEMId,std::uint16_t>::iterator it = reqed_slot_.begin(); it != reqed_slot_.end(); ++it) {
-	nlist[x] = it->first;
-	reqlist[x] = it->second;
-	x++;
+    // complete re-assign, one slot per requester per round
+    std::vector<std::pair<EMANE::NEMId,std::uint16_t>> reqlist;
+    reqlist.reserve(reqed_slot_.size());
+    for (auto & req : reqed_slot_) {
+	if (req.second>0) reqlist.push_back(req);
+    }
+    fill(std::move(reqlist));
+    return true;
+}
+
+void 
+EMANE::Models::TDMA::TDMASlotMap::fill(std::vector<std::pair<EMANE::NEMId,std::uint16_t>> reqlist)
+{
+    std::uint16_t used = 0;
+    while (!reqlist.empty() && used<slot_a_cycle_) {
+	size_t kept = 0;
+	for (size_t i=0;i<reqlist.size() && used<slot_a_cycle_;i++) {
+	    assign(used++,reqlist[i].first);
+	    if (--reqlist[i].second>0) reqlist[kept++] = reqlist[i];
+	}
+	reqlist.resize(kept);
+    }
+    for (std::uint16_t i=used;i<slot_a_cycle_;i++) assign(i,0);
+}
+
+void 
+EMANE::Models::TDMA::TDMASlotMap::setNeighbors(EMANE::NEMId nodeid, const NeighborList & neighbors)
+{
+    if (!reuse_) {
+	// current owners become members with what they hold
+	for (auto & owner : node_slot_) {
+	    std::uint16_t & req = reqed_slot_[owner.first];
+	    req = std::max<std::uint16_t>(req,owner.second.size());
+	}
+	reuse_ = true;
     }
-    for (int i=0;i<slot_a_cycle_;i++) { used_slot_[i] = 0; avai_slot_[i] = 0; }
-    int used = 0;
-    for (std::uint16_t k=0;k<slot_a_cycle_;k++) {
-	for (std::uint16_t i=0;i<nodenum;i++) {
-	    if (reqlist[i]>0) {
-	    	used_slot_[used] = nlist[i];
-	    	reqlist[i]--;
-		used++;
-		if (used==slot_a_cycle_) break;
+    neighbors_[nodeid] = std::set<EMANE::NEMId>(neighbors.begin(),neighbors.end());
+    addMember(nodeid);
+}
+
+void 
+EMANE::Models::TDMA::TDMASlotMap::addMember(EMANE::NEMId nodeid)
+{
+    std::uint16_t & req = reqed_slot_[nodeid];
+    if (req == 0) req = 1;
+    pending_ = true;
+}
+
+bool 
+EMANE::Models::TDMA::TDMASlotMap::isReuse()
+{
+    return reuse_;
+}
+
+const EMANE::Models::TDMA::SlotGroups & 
+EMANE::Models::TDMA::TDMASlotMap::getGroups()
+{
+    return groups_;
+}
+
+bool 
+EMANE::Models::TDMA::TDMASlotMap::groupsChanged()
+{
+    return groupsChanged_;
+}
+
+void 
+EMANE::Models::TDMA::TDMASlotMap::colorAndAssign()
+{
+    // members are all NEMs that joined or reported
+    std::set<EMANE::NEMId> members;
+    for (auto & req : reqed_slot_) members.insert(req.first);
+    for (auto & nbr : neighbors_) members.insert(nbr.first);
+
+    // links count if either end reported them
+    std::map<EMANE::NEMId,std::set<EMANE::NEMId>> links;
+    for (auto & nbr : neighbors_) {
+	for (auto other : nbr.second) {
+	    if (other == nbr.first) continue;
+	    links[nbr.first].insert(other);
+	    links[other].insert(nbr.first);
+	}
+    }
+
+    // two NEMs conflict within two hops, a NEM that never reported
+    // conflicts with everybody
+    std::map<EMANE::NEMId,std::set<EMANE::NEMId>> conflicts;
+    for (auto id : members) {
+	std::set<EMANE::NEMId> & conflict = conflicts[id];
+	if (neighbors_.count(id) == 0) {
+	    conflict = members;
+	}
+	else {
+	    auto & onehop = links[id];
+	    for (auto hop1 : onehop) {
+		if (members.count(hop1)) conflict.insert(hop1);
+		for (auto hop2 : links[hop1]) {
+		    if (members.count(hop2)) conflict.insert(hop2);
+		}
 	    }
 	}
-	if (used==slot_a_cycle_) break;
+	conflict.erase(id);
     }
-    delete nlist;
-    delete reqlist;
-    return true;
+    for (auto & conflict : conflicts) {
+	for (auto other : conflict.second) conflicts[other].insert(conflict.first);
+    }
+
+    // greedy coloring, most constrained first
+    std::vector<EMANE::NEMId> order(members.begin(),members.end());
+    std::stable_sort(order.begin(),order.end(),
+		     [&conflicts](EMANE::NEMId a, EMANE::NEMId b)
+		     {
+			 return conflicts[a].size() > conflicts[b].size();
+		     });
+
+    std::map<EMANE::NEMId,EMANE::NEMId> group;
+    std::map<EMANE::NEMId,std::uint16_t> demand;	// by group
+    for (auto id : order) {
+	std::set<EMANE::NEMId> taken;
+	for (auto other : conflicts[id]) {
+	    auto iter = group.find(other);
+	    if (iter != group.end()) taken.insert(iter->second);
+	}
+	EMANE::NEMId color = 1;
+	while (taken.count(color)) color++;
+	group[id] = color;
+	// a group gets what its most demanding member asked for
+	std::uint16_t req = std::max<std::uint16_t>(reqed_slot_[id],1);
+	std::uint16_t & want = demand[color];
+	want = std::max(want,req);
+    }
+
+    SlotGroups groups(group.begin(),group.end());
+    if (groups != groups_) {
+	groups_.swap(groups);
+	groupsChanged_ = true;
+    }
+
+    fill(std::vector<std::pair<EMANE::NEMId,std::uint16_t>>(demand.begin(),demand.end()));
 }
 
 void 
 EMANE::Models::TDMA::TDMASlotMap::setReqNum(EMANE::NEMId nodeid,std::uint16_t reqnum)
 {
     reqed_slot_[nodeid] = reqnum;
+    pending_ = true;
 }
 
 
@@ -492,11 +829,37 @@ EMANE::Models::TDMA::TDMASlotMap::getOwner(std::uint16_t slot)
 void 
 EMANE::Models::TDMA::TDMASlotMap::setOwner(std::uint16_t slot, EMANE::NEMId owner)
 {
-	used_slot_[slot] = owner;
+	assign(slot,owner);
 }
-std::vector<EMANE::NEMId> & 
+
+const std::vector<EMANE::NEMId> & 
 EMANE::Models::TDMA::TDMASlotMap::getMap()
 {
 	return used_slot_;
 }
 
+std::uint32_t 
+EMANE::Models::TDMA::TDMASlotMap::getVersion()
+{
+	return version_;
+}
+
+EMANE::Models::TDMA::SlotChanges 
+EMANE::Models::TDMA::TDMASlotMap::getChanges()
+{
+	SlotChanges changes;
+	for (auto slot : dirty_slot_) {
+	    if (used_slot_[slot] != published_slot_[slot]) changes.push_back(std::make_pair(slot,used_slot_[slot]));
+	}
+	return changes;
+}
+
+void 
+EMANE::Models::TDMA::TDMASlotMap::publish()
+{
+	for (auto slot : dirty_slot_) published_slot_[slot] = used_slot_[slot];
+	dirty_slot_.clear();
+	groupsChanged_ = false;
+	version_++;
+	if (version_ == 0) version_++;	// 0 means no version
+}
@@ -36,12 +36,14 @@
 #ifndef EMANEAPPLICATIONTDMAMANAGER_HEADAER_
 #define EMANEAPPLICATIONTDMAMANAGER_HEADAER_
 
+#include <atomic>
 #include <mutex>
 #include <memory>
 #include <thread>
 #include <vector>
 #include <set>
 #include <map>
+#include <unordered_map>
 
 #include <emane/registrar.h>
 #include <emane/timerserviceuser.h>
@@ -69,7 +71,9 @@ namespace EMANE
 	std::uint32_t getSlotLen();
 	NEMId getOwner(std::uint16_t slot);
 	void setOwner(std::uint16_t slot, NEMId owner);
-	std::vector<EMANE::NEMId> & getMap();
+	const std::vector<EMANE::NEMId> & getMap();
+	// first slot nobody owns, -1 if none
+	std::int32_t getUnowned();
 
 	void setSlotLen(std::uint32_t len);
 	std::uint16_t getUsedNum(EMANE::NEMId nodeid);
@@ -77,15 +81,45 @@ namespace EMANE
 	bool needReassign();
 	bool reassign(std::uint16_t need, EMANE::NEMId nodeid);
 	void setReqNum(EMANE::NEMId nodeid,std::uint16_t reqnum);
+	// serves all demand recorded since the last call in one pass
+	bool allocate();
+
+	std::uint32_t getVersion();
+	SlotChanges getChanges();
+	void publish();
+
+	// spatial reuse, entered on the first neighbor report: slots are
+	// owned by groups of NEMs more than two hops apart
+	void setNeighbors(EMANE::NEMId nodeid, const NeighborList & neighbors);
+	void addMember(EMANE::NEMId nodeid);
+	bool isReuse();
+	const SlotGroups & getGroups();
+	bool groupsChanged();
 
 	private:
+	// every owner change goes through here to keep the indexes below current
+	void assign(std::uint16_t slot, EMANE::NEMId owner);
+	// round robin over (owner, slots wanted) from slot 0, the rest unowned
+	void fill(std::vector<std::pair<EMANE::NEMId,std::uint16_t>> reqlist);
+	void colorAndAssign();
+
 	std::uint16_t sub_id_;
 	std::uint16_t slot_a_cycle_;
 	std::vector<EMANE::NEMId> used_slot_;
-	std::vector<EMANE::NEMId> avai_slot_;
+	std::vector<EMANE::NEMId> avai_slot_;	// released, still used until taken
 	std::map<EMANE::NEMId,std::uint16_t> reqed_slot_;
+	std::unordered_map<EMANE::NEMId,std::set<std::uint16_t>> node_slot_;
+	std::set<std::uint16_t> free_slot_;	// unowned or released, lowest first
+	std::set<std::uint16_t> dirty_slot_;	// changed since publish()
 	std::uint32_t slot_length_;
 	bool dynamic_;
+	std::vector<EMANE::NEMId> published_slot_;	// slot map as of version_
+	std::uint32_t version_;
+	bool pending_;		// demand changed since the last allocate()
+	bool reuse_;
+	std::map<EMANE::NEMId,std::set<EMANE::NEMId>> neighbors_;	// as reported
+	SlotGroups groups_;	// group id (color+1) by NEM
+	bool groupsChanged_;	// since publish()
     };
 
     class MACLayer;
@@ -102,7 +136,10 @@ namespace EMANE
 	TDMAManager(PlatformServiceProvider *pPlatformServiceProvider);
 	~TDMAManager();
 
-      	void initialize(std::auto_ptr<MACLayer> eventproxy, NEMId nid);
+	// eventproxy is not owned, see TDMAManagerRegistry
+      	void initialize(MACLayer * eventproxy, NEMId nid);
+	// moves the proxy role to another layer, completed on that layer's thread
+	void setProxy(MACLayer * eventproxy, NEMId nid, PlatformServiceProvider *pPlatformServiceProvider);
 	void sendInitEvent(std::string uuid);
 
 	void notManager();
@@ -119,24 +156,89 @@ namespace EMANE
                                          const void * arg);
 
 	private:
-	void sendSlotMap(TDMASlotMap & slotmap);
-	void setDynTimer(std::uint16_t netid, std::uint32_t dynlen);
-
-	PlatformServiceProvider *pPlatformService_;
-
-      	bool isTdmaManager_;
-      	bool isTdmaInited_;
+	// state of one subnet, only touched on the proxy layer's thread which
+	// carries all manager events and timers
+	struct Subnet
+	{
+	    Subnet(std::uint16_t subid, std::uint16_t slotnum) :
+		slotmap_(subid,slotnum),
+		dynPending_(false),
+		activationCycle_(0)
+	    { }
+
+	    // a map sent now switches with the one the armed timer sends, else
+	    // 0 lets the receivers switch at their next cycle
+	    std::uint64_t activation() const { return dynPending_ ? activationCycle_ : 0; }
+
+	    TDMASlotMap slotmap_;
+	    bool dynPending_;		// allocation timer armed
+	    std::uint64_t activationCycle_;	// for the map the armed timer sends
+	};
+
+	Subnet * getSubnet(std::uint16_t subid);
+	Subnet * addSubnet(std::uint16_t subid, std::uint16_t slotnum, std::uint32_t slotlen);
+	void join(TDMASlotMap & slotmap, NEMId nodeid, const std::string & cfgstr);
+	// activation is the cycle the receivers switch at, 0 for their next
+	// one; a receiver without a map yet switches at once
+	void sendSlotMap(TDMASlotMap & slotmap, bool full = false, std::uint64_t activation = 0);
+	void setDynTimer(Subnet & subnet, std::uint32_t dynlen);
+	void takeProxy(MACLayer * eventproxy, NEMId nid, PlatformServiceProvider *pPlatformServiceProvider);
+
+	std::atomic<PlatformServiceProvider *> pPlatformService_;
+
+      	std::atomic<bool> isTdmaManager_;
+      	std::atomic<bool> isTdmaInited_;
 	BuildId buildId_;
 	std::string strUuid_;
-	std::vector<TDMASlotMap> networks_;
+	std::unordered_map<std::uint16_t,std::unique_ptr<Subnet>> networks_;
+	std::mutex networksLock_;	// guards networks_ itself, not the subnets
 	std::uint64_t slotBaseTime_;
 
-	std::map<TimerEventId,std::uint16_t> dyn_send_timer_;
-	std::set<TimerEventId> dyn_timer_;
-	std::set<std::uint16_t> dyn_net_;
+	std::map<TimerEventId,std::uint16_t> dyn_send_timer_;	// subid by timer
+	std::mutex timerLock_;
+
+	std::atomic<MACLayer *> eventProxy_;
+	std::atomic<NEMId> proxyNid_;
+	std::atomic<std::uint32_t> proxyGeneration_;	// last setProxy handoff
+
+	// election state, recursive since the proxy feeds events it sends on
+	// our behalf back to us
+	std::recursive_mutex lock_;
+    };
+
+    /**
+     * @class TDMAManagerRegistry
+     *
+     * @brief Owns the TDMA manager of this emulator process and
+     * tracks the MAC layers sharing it.
+     *
+     */
+    class TDMAManagerRegistry
+    {
+	public:
+	static TDMAManagerRegistry & instance();
+
+	// the first layer registered acts as the manager proxy
+	TDMAManager * registerLayer(MACLayer * layer, NEMId nid,
+				    PlatformServiceProvider *pPlatformServiceProvider);
 
-	std::auto_ptr<MACLayer> eventProxy_;
-	NEMId proxyNid_;
+	// the manager is destroyed with the last layer
+	void unregisterLayer(MACLayer * layer);
+
+	private:
+	struct Member
+	{
+	    MACLayer * layer_;
+	    NEMId nid_;
+	    PlatformServiceProvider * pPlatformService_;
+	};
+
+	TDMAManagerRegistry();
+
+	std::mutex lock_;
+	std::unique_ptr<TDMAManager> manager_;
+	std::vector<Member> members_;
+	NEMId proxy_;	// last layer handed the proxy role
     };
 
     }